@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QApplication>
+#include <QLineEdit>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "emoji-db.hpp"
+#include "latency-probe.hpp"
+#include "q-jome-window.hpp"
+#include "q-emojis-widget.hpp"
+#include "q-jome-style.hpp"
+
+/*
+ * Benchmark of the interactive paths of jome.
+ *
+ * Usage: jome-bench DATA-DIR [BENCH]...
+ *
+ * Without any `BENCH`, runs all the benchmarks. Unless
+ * `QT_QPA_PLATFORM` is set, this uses the offscreen Qt platform so that
+ * it runs without a display: the paints are real, but go to memory.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Durations = std::vector<std::chrono::microseconds>;
+
+// runs `func()` and returns its duration
+template <typename FuncT>
+std::chrono::microseconds measure(FuncT&& func)
+{
+    const auto start = Clock::now();
+
+    func();
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                 start);
+}
+
+void printStats(const std::string& name, Durations durations)
+{
+    if (durations.empty()) {
+        return;
+    }
+
+    std::sort(std::begin(durations), std::end(durations));
+
+    const auto ms = [](const std::chrono::microseconds duration) {
+        return duration.count() / 1000.;
+    };
+
+    std::printf("%-40s %6zu samples   median %8.3f ms   p90 %8.3f ms   max %8.3f ms\n",
+                name.c_str(), durations.size(),
+                ms(durations[durations.size() / 2]),
+                ms(durations[durations.size() * 9 / 10]),
+                ms(durations.back()));
+}
+
+// sends a key press and release to `widget`
+void sendKey(QWidget& widget, const int key, const QString& text = {})
+{
+    QKeyEvent pressEvent {QEvent::KeyPress, key, Qt::NoModifier, text};
+    QKeyEvent releaseEvent {QEvent::KeyRelease, key, Qt::NoModifier, text};
+
+    QApplication::sendEvent(&widget, &pressEvent);
+    QApplication::sendEvent(&widget, &releaseEvent);
+}
+
+/*
+ * Types broad queries in the find box of a shown window: each sample
+ * is a key press until the emojis are painted again.
+ */
+void benchKeystrokes(const jome::EmojiDb& db)
+{
+    jome::LatencyProbe latencyProbe;
+    jome::QJomeWindow window {db, boost::none, boost::none, &latencyProbe};
+
+    window.show();
+    QApplication::processEvents();
+
+    auto& searchBox = *window.findChild<QLineEdit *>();
+    auto& emojisViewport = *window.findChild<jome::QEmojisWidget *>()->viewport();
+    Durations durations;
+
+    // few letters: many results
+    const std::vector<QString> words {"a", "e", "face", "o", "smiling", "s"};
+
+    for (auto round = 0; round < 10; ++round) {
+        for (const auto& word : words) {
+            for (const auto ch : word) {
+                durations.push_back(measure([&] {
+                    sendKey(searchBox, ch.toUpper().unicode(), QString {ch});
+                    emojisViewport.repaint();
+                }));
+            }
+
+            for (auto i = 0; i < word.size(); ++i) {
+                durations.push_back(measure([&] {
+                    sendKey(searchBox, Qt::Key_Backspace);
+                    emojisViewport.repaint();
+                }));
+            }
+        }
+    }
+
+    printStats("keystroke (find, update, paint)", std::move(durations));
+    std::cout << latencyProbe.report();
+}
+
+// sets a flag when its watched widget gets a paint event
+class PaintWatcher :
+    public QObject
+{
+public:
+    explicit PaintWatcher(QWidget& widget) :
+        QObject {&widget}
+    {
+        widget.installEventFilter(this);
+    }
+
+    bool painted() const noexcept
+    {
+        return _painted;
+    }
+
+private:
+    bool eventFilter(QObject * const obj, QEvent * const event) override
+    {
+        if (event->type() == QEvent::Paint) {
+            _painted = true;
+        }
+
+        return QObject::eventFilter(obj, event);
+    }
+
+private:
+    bool _painted = false;
+};
+
+// shows `window` and returns the duration until the emojis are painted
+std::chrono::microseconds showUntilPainted(jome::QJomeWindow& window)
+{
+    auto& emojisViewport = *window.findChild<jome::QEmojisWidget *>()->viewport();
+    PaintWatcher paintWatcher {emojisViewport};
+
+    return measure([&] {
+        window.show();
+
+        while (!paintWatcher.painted()) {
+            QApplication::processEvents();
+        }
+    });
+}
+
+/*
+ * Creates windows (widgets, palettes, fonts, and style) and shows them
+ * for the first time, until the emojis are painted.
+ */
+void benchWindow(const jome::EmojiDb& db)
+{
+    Durations constructDurations, firstShowDurations;
+
+    for (auto round = 0; round < 10; ++round) {
+        std::unique_ptr<jome::QJomeWindow> window;
+
+        constructDurations.push_back(measure([&] {
+            window = std::make_unique<jome::QJomeWindow>(db);
+        }));
+        firstShowDurations.push_back(showUntilPainted(*window));
+    }
+
+    printStats("window construction", std::move(constructDurations));
+    printStats("window first show", std::move(firstShowDurations));
+}
+
+/*
+ * Shows a window like the `pick` command of the server mode does, until
+ * the emojis are painted:
+ *
+ * Cold::
+ *     New window.
+ *
+ * Prepared::
+ *     New window prepared with QJomeWindow::prepare(), like the server
+ *     does right after starting.
+ *
+ * Again::
+ *     Window shown and hidden before.
+ */
+void benchPick(const jome::EmojiDb& db)
+{
+    Durations coldDurations, preparedDurations, againDurations;
+
+    for (auto round = 0; round < 10; ++round) {
+        {
+            jome::QJomeWindow window {db};
+
+            coldDurations.push_back(showUntilPainted(window));
+        }
+
+        jome::QJomeWindow window {db};
+
+        window.prepare();
+        preparedDurations.push_back(showUntilPainted(window));
+        window.hide();
+        QApplication::processEvents();
+        againDurations.push_back(showUntilPainted(window));
+    }
+
+    printStats("pick to first frame (cold)", std::move(coldDurations));
+    printStats("pick to first frame (prepared)", std::move(preparedDurations));
+    printStats("pick to first frame (again)", std::move(againDurations));
+}
+
+/*
+ * Rebuilds the emojis of a shown window (column count change), then
+ * moves the mouse over the emojis: each mouse move sample is a mouse
+ * move event until the hovered emoji is painted.
+ */
+void benchRebuild(const jome::EmojiDb& db)
+{
+    jome::QJomeWindow window {db};
+
+    window.show();
+    QApplication::processEvents();
+
+    auto& emojisWidget = *window.findChild<jome::QEmojisWidget *>();
+    auto& emojisViewport = *emojisWidget.viewport();
+    Durations rebuildDurations, mouseMoveDurations;
+
+    for (auto round = 0; round < 10; ++round) {
+        rebuildDurations.push_back(measure([&] {
+            emojisWidget.rebuild();
+            emojisViewport.repaint();
+        }));
+    }
+
+    // half a cell apart: every other move changes the hovered emoji
+    const auto step = jome::QEmojisWidget::emojiSize / 2;
+
+    for (auto y = 0; y < emojisViewport.height(); y += step) {
+        for (auto x = 0; x < emojisViewport.width(); x += step) {
+            mouseMoveDurations.push_back(measure([&] {
+                QMouseEvent event {
+                    QEvent::MouseMove, QPointF(x, y), Qt::NoButton,
+                    Qt::NoButton, Qt::NoModifier
+                };
+
+                QApplication::sendEvent(&emojisViewport, &event);
+                QApplication::processEvents();
+            }));
+        }
+    }
+
+    printStats("rebuild", std::move(rebuildDurations));
+    printStats("mouse move (hit-test, paint)", std::move(mouseMoveDurations));
+}
+
+struct Bench
+{
+    const char *name;
+    std::function<void (const jome::EmojiDb&)> func;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app {argc, argv};
+
+    // don't touch the settings of the user
+    app.setOrganizationName("jome-bench");
+    app.setApplicationName("jome-bench");
+
+    // like jome, so that the windows draw what they draw for the user
+    app.setStyle(new jome::QJomeStyle);
+
+    if (argc < 2) {
+        std::cerr << "Usage: jome-bench DATA-DIR [BENCH]..." << std::endl;
+        return 2;
+    }
+
+    const std::vector<Bench> benches {
+        {"keystrokes", benchKeystrokes},
+        {"window", benchWindow},
+        {"pick", benchPick},
+        {"rebuild", benchRebuild},
+    };
+
+    const std::vector<std::string> names {argv + 2, argv + argc};
+    const jome::EmojiDb db {argv[1]};
+
+    for (const auto& bench : benches) {
+        if (!names.empty() && std::find(std::begin(names), std::end(names),
+                                        bench.name) == std::end(names)) {
+            continue;
+        }
+
+        std::cout << "== " << bench.name << std::endl;
+        bench.func(db);
+    }
+
+    return 0;
+}
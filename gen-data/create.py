@@ -11,6 +11,8 @@ import sys
 import cairosvg
 import cairo
 import os.path
+import shutil
+import unicodedata
 
 
 class _EmojiDescriptor:
@@ -157,8 +159,19 @@ def _gen_cats_json(output_dir, categories):
         json.dump(cats_json, f, ensure_ascii=False, indent=2)
 
 
-def _gen_emoji_pngs_from_svgs(output_dir):
-    png_dir = os.path.join(output_dir, 'twemoji-png-32')
+# emoji image sizes (pixels) of the atlases (first one is the base size)
+_EMOJI_SIZES = (32, 64, 128)
+
+
+def _emojis_png_file_name(size):
+    if size == _EMOJI_SIZES[0]:
+        return 'emojis.png'
+
+    return 'emojis-{}.png'.format(size)
+
+
+def _gen_emoji_pngs_from_svgs(output_dir, size):
+    png_dir = os.path.join(output_dir, 'twemoji-png-{}'.format(size))
 
     if os.path.exists(png_dir):
         return
@@ -172,7 +185,7 @@ def _gen_emoji_pngs_from_svgs(output_dir):
         file_name_no_ext = file_name[:-4]
         cairosvg.svg2png(url=os.path.join('twemoji-svg', file_name),
                          write_to=os.path.join(png_dir, '{}.png'.format(file_name_no_ext)),
-                         parent_width=32, parent_height=32)
+                         parent_width=size, parent_height=size)
 
 
 def _get_emoji_png_file_names(emoji):
@@ -186,13 +199,50 @@ def _get_emoji_png_file_names(emoji):
     return file_names
 
 
-def _gen_emojis_png(output_dir, emoji_descriptors):
+# skin tone modifiers (light to dark)
+_SKIN_TONE_MODIFIERS = (0x1f3fb, 0x1f3fc, 0x1f3fd, 0x1f3fe, 0x1f3ff)
+
+
+def _gen_skin_tone_pngs(output_dir, emoji_descriptors, size):
+    # jome loads those files on demand, one per emoji and skin tone
+    out_dir = os.path.join(output_dir, 'skin-tones-{}'.format(size))
+    os.makedirs(out_dir, exist_ok=True)
+
+    for emoji_descr in emoji_descriptors:
+        if not emoji_descr.has_skin_tone_support:
+            continue
+
+        for modifier in _SKIN_TONE_MODIFIERS:
+            # like `jome::Emoji::codepointsWithSkinTone()`
+            emoji = emoji_descr.emoji[0] + chr(modifier) + emoji_descr.emoji[1:]
+            existing_path = None
+
+            for file_name in _get_emoji_png_file_names(emoji):
+                path = os.path.join(output_dir, 'twemoji-png-{}'.format(size),
+                                    file_name)
+
+                if os.path.exists(path):
+                    existing_path = path
+                    break
+
+            if existing_path is None:
+                # jome falls back to the emoji without a skin tone
+                print('Cannot find PNG file for emoji `{}`: skipping.'.format(emoji))
+                continue
+
+            out_file_name = _get_emoji_png_file_names(emoji)[0]
+            shutil.copyfile(existing_path, os.path.join(out_dir, out_file_name))
+
+
+def _gen_emojis_png(output_dir, emoji_descriptors, size):
+    # locations are in base size pixels for all the sizes
+    base_size = _EMOJI_SIZES[0]
     cols = 32
     rows = len(emoji_descriptors) // cols + 1
     locations = {}
     col = 0
     row = 0
-    out_surf = cairo.ImageSurface(cairo.Format.ARGB32, cols * 32, rows * 32)
+    out_surf = cairo.ImageSurface(cairo.Format.ARGB32, cols * size, rows * size)
     cr = cairo.Context(out_surf)
 
     for emoji_descr in emoji_descriptors:
@@ -201,7 +251,8 @@ def _gen_emojis_png(output_dir, emoji_descriptors):
         existing_path = None
 
         for file_name in file_names:
-            path = os.path.join(output_dir, 'twemoji-png-32', file_name)
+            path = os.path.join(output_dir, 'twemoji-png-{}'.format(size),
+                                file_name)
 
             if os.path.exists(path):
                 existing_path = path
@@ -210,16 +261,14 @@ def _gen_emojis_png(output_dir, emoji_descriptors):
             _error('Cannot find PNG file for emoji `{}`; candidates are {}.'.format(emoji, file_names))
 
         emoji_surf = cairo.ImageSurface.create_from_png(existing_path)
-        loc_x = col * 32
-        loc_y = row * 32
         cr.save()
-        cr.translate(loc_x, loc_y)
+        cr.translate(col * size, row * size)
         cr.set_source_surface(emoji_surf)
-        cr.rectangle(0, 0, 32, 32)
+        cr.rectangle(0, 0, size, size)
         cr.fill()
         cr.restore()
         emoji_surf.finish()
-        locations[emoji] = [loc_x, loc_y]
+        locations[emoji] = [col * base_size, row * base_size]
 
         if col == cols - 1:
             col = 0
@@ -227,13 +276,66 @@ def _gen_emojis_png(output_dir, emoji_descriptors):
         else:
             col += 1
 
-    out_surf.write_to_png(os.path.join(output_dir, 'emojis.png'))
+    out_surf.write_to_png(os.path.join(output_dir, _emojis_png_file_name(size)))
     out_surf.finish()
 
+    if size != base_size:
+        return
+
     with open(os.path.join(output_dir, 'emojis-png-locations.json'), 'w') as f:
         json.dump(locations, f, ensure_ascii=False, indent=2)
 
 
+def _gen_unicode_names(output_dir):
+    # see `jome::UnicodeDb`
+    with open(os.path.join(output_dir, 'unicode-names.txt'), 'w') as f:
+        f.write('# Unicode {}\n'.format(unicodedata.unidata_version))
+        range_first = None
+        range_last = None
+        range_prefix = None
+
+        def write_range():
+            if range_first is None:
+                return
+
+            if range_first == range_last:
+                f.write('{:x} {}-{:04X}\n'.format(range_first, range_prefix,
+                                                   range_first))
+            else:
+                f.write('{:x}..{:x} {}\n'.format(range_first, range_last,
+                                                  range_prefix))
+
+        for cp in range(0x110000):
+            name = unicodedata.name(chr(cp), None)
+
+            if name is None:
+                # unassigned, control, surrogate, or private use
+                continue
+
+            # algorithmic names like `CJK UNIFIED IDEOGRAPH-4E00`
+            suffix = '-{:04X}'.format(cp)
+
+            if name.endswith(suffix):
+                prefix = name[:-len(suffix)]
+
+                if range_prefix == prefix and range_last == cp - 1:
+                    range_last = cp
+                    continue
+
+                write_range()
+                range_first = cp
+                range_last = cp
+                range_prefix = prefix
+                continue
+
+            write_range()
+            range_first = None
+            range_prefix = None
+            f.write('{:x} {}\n'.format(cp, name))
+
+        write_range()
+
+
 def _main(output_dir):
     os.makedirs(output_dir, exist_ok=True)
     emoji_json_entries = _get_emoji_json_entries()
@@ -271,10 +373,16 @@ def _main(output_dir):
     _gen_emojis_json(output_dir, emoji_descriptors)
     print('Creating `cats.json`')
     _gen_cats_json(output_dir, categories)
-    print('Creating `twemoji-png-32`')
-    _gen_emoji_pngs_from_svgs(output_dir)
-    print('Creating `emojis.png` and `emojis-png-locations.json`')
-    _gen_emojis_png(output_dir, emoji_descriptors)
+    print('Creating `unicode-names.txt`')
+    _gen_unicode_names(output_dir)
+
+    for size in _EMOJI_SIZES:
+        print('Creating `twemoji-png-{}`'.format(size))
+        _gen_emoji_pngs_from_svgs(output_dir, size)
+        print('Creating `{}`'.format(_emojis_png_file_name(size)))
+        _gen_emojis_png(output_dir, emoji_descriptors, size)
+        print('Creating `skin-tones-{}`'.format(size))
+        _gen_skin_tone_pngs(output_dir, emoji_descriptors, size)
 
 
 if __name__ == '__main__':
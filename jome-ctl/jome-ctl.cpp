@@ -44,6 +44,8 @@ static Params parseArgs(QCoreApplication& app, int argc, char **argv)
 
         if (cmd == "quit") {
             params.cmd = jome::QCtlClient::Command::QUIT;
+        } else if (cmd == "stats") {
+            params.cmd = jome::QCtlClient::Command::STATS;
         } else if (cmd != "pick") {
             std::cerr << "Command-line error: unknown command `" <<
                          cmd.toUtf8().constData() << "`." << std::endl;
@@ -68,7 +70,8 @@ int main(int argc, char **argv)
 
     QObject::connect(&client, &jome::QCtlClient::serverReplied,
                      [&params, &app](const std::string& str) {
-        if (params.cmd == jome::QCtlClient::Command::PICK) {
+        if (params.cmd == jome::QCtlClient::Command::PICK ||
+                params.cmd == jome::QCtlClient::Command::STATS) {
             std::cout << str;
             std::cout.flush();
         }
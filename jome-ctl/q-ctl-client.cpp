@@ -51,6 +51,10 @@ void QCtlClient::_socketConnected()
     case Command::QUIT:
         this->_sendString("quit");
         break;
+
+    case Command::STATS:
+        this->_sendString("stats");
+        break;
     }
 }
 
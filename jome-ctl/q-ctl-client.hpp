@@ -22,6 +22,7 @@ public:
     enum class Command {
         PICK,
         QUIT,
+        STATS,
     };
 
 public:
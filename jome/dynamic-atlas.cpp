@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "dynamic-atlas.hpp"
+
+namespace jome {
+
+DynamicAtlas::DynamicAtlas(const std::size_t maxBytes, const int pageSize,
+                           const qreal devicePixelRatio) :
+    _maxBytes {maxBytes},
+    _pageSize {_pageSizeForMaxBytes(pageSize, maxBytes)},
+    _devicePixelRatio {devicePixelRatio}
+{
+}
+
+int DynamicAtlas::_pageSizeForMaxBytes(const int pageSize,
+                                       const std::size_t maxBytes)
+{
+    // largest square page of 32-bit pixels within `maxBytes`
+    const auto maxPageSize = static_cast<int>(std::sqrt(static_cast<double>(maxBytes / 4)));
+
+    return std::min(pageSize, maxPageSize);
+}
+
+std::size_t DynamicAtlas::_pageBytes() const noexcept
+{
+    return static_cast<std::size_t>(_pageSize) * _pageSize * 4;
+}
+
+std::size_t DynamicAtlas::bytes() const noexcept
+{
+    return _pages.size() * this->_pageBytes();
+}
+
+void DynamicAtlas::clear()
+{
+    _pages.clear();
+    _entries.clear();
+    _lru.clear();
+}
+
+bool DynamicAtlas::_allocRectInPage(_Page& page, const int size,
+                                    QRect& rect)
+{
+    /*
+     * First shelf of the same height with enough room; images of a
+     * given size always go to shelves of this height, so that there's
+     * no wasted space within a shelf.
+     */
+    for (auto& shelf : page.shelves) {
+        if (shelf.height == size && shelf.nextX + size <= _pageSize) {
+            rect = {shelf.nextX, shelf.y, size, size};
+            shelf.nextX += size;
+            return true;
+        }
+    }
+
+    // new shelf
+    if (page.nextShelfY + size > _pageSize) {
+        return false;
+    }
+
+    page.shelves.push_back({page.nextShelfY, size, size});
+    rect = {0, page.nextShelfY, size, size};
+    page.nextShelfY += size;
+    return true;
+}
+
+bool DynamicAtlas::_allocRect(const int size, Slot& slot)
+{
+    for (auto& page : _pages) {
+        if (this->_allocRectInPage(*page, size, slot.rect)) {
+            slot.pixmap = &page->pixmap;
+            return true;
+        }
+    }
+
+    if (this->bytes() + this->_pageBytes() > _maxBytes) {
+        // no room for a new page
+        return false;
+    }
+
+    auto page = std::make_unique<_Page>();
+
+    page->pixmap = QPixmap {_pageSize, _pageSize};
+    page->pixmap.fill(Qt::transparent);
+    page->pixmap.setDevicePixelRatio(_devicePixelRatio);
+
+    const auto ok = this->_allocRectInPage(*page, size, slot.rect);
+
+    slot.pixmap = &page->pixmap;
+    _pages.push_back(std::move(page));
+    return ok;
+}
+
+bool DynamicAtlas::_evictForSize(const int size, Slot& slot)
+{
+    /*
+     * Least recently used image of the same size: the other images
+     * stay, as their room can't hold an image of this size anyway.
+     */
+    const auto lruIt = std::find_if(std::begin(_lru), std::end(_lru),
+                                    [size](const Key& key) {
+        return static_cast<int>(key.size) == size;
+    });
+
+    if (lruIt == std::end(_lru)) {
+        return false;
+    }
+
+    const auto it = _entries.find(*lruIt);
+
+    assert(it != std::end(_entries));
+    slot = it->second.slot;
+    _entries.erase(it);
+    _lru.erase(lruIt);
+    return true;
+}
+
+DynamicAtlas::Slot DynamicAtlas::_insert(const Key& key, const QImage& image)
+{
+    const auto size = static_cast<int>(key.size);
+
+    if (size > _pageSize) {
+        // can't keep it (tiny maximum number of bytes)
+        return {nullptr, {}};
+    }
+
+    Slot slot;
+
+    if (!this->_allocRect(size, slot) && !this->_evictForSize(size, slot)) {
+        // no image of this size: start over with empty pages
+        this->clear();
+
+        const auto ok = this->_allocRect(size, slot);
+
+        static_cast<void>(ok);
+        assert(ok);
+    }
+
+    {
+        QPainter painter {const_cast<QPixmap *>(slot.pixmap)};
+
+        // painter coordinates are logical pixels
+        const QRectF targetRect {
+            slot.rect.x() / _devicePixelRatio,
+            slot.rect.y() / _devicePixelRatio,
+            slot.rect.width() / _devicePixelRatio,
+            slot.rect.height() / _devicePixelRatio,
+        };
+
+        // replace what an evicted image possibly left there
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(targetRect, image, QRectF {image.rect()});
+    }
+
+    _lru.push_back(key);
+    _entries[key] = {slot, std::prev(std::end(_lru))};
+    return slot;
+}
+
+} // namespace jome
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_DYNAMIC_ATLAS_HPP
+#define _JOME_DYNAMIC_ATLAS_HPP
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <cstddef>
+#include <QPixmap>
+#include <QImage>
+#include <QPainter>
+#include <QPoint>
+#include <QRect>
+
+#include "emoji-db.hpp"
+
+namespace jome {
+
+/*
+ * Runtime atlas of images which aren't part of the emoji PNG file
+ * (see EmojiImages): skin tone variants, larger previews, and the
+ * like.
+ *
+ * An atlas packs its images into a few large pixmaps (pages) with
+ * shelf packing: each page is a stack of shelves, each shelf being a
+ * row of images of the same height. An image is identified by its key
+ * (emoji, variant, and size).
+ *
+ * The pages of an atlas never use more than a given number of bytes:
+ * when there's no room left for a new image, the atlas evicts the
+ * least recently used image of the same size and puts the new image in
+ * its room. Evicting images of other sizes wouldn't make room for it,
+ * so without any image of the same size, the atlas starts over with
+ * empty pages.
+ */
+class DynamicAtlas
+{
+public:
+    struct Key
+    {
+        bool operator==(const Key& other) const noexcept
+        {
+            return emoji == other.emoji && variant == other.variant &&
+                   size == other.size;
+        }
+
+        const Emoji *emoji;
+
+        // user-defined variant (skin tone, for example)
+        unsigned int variant;
+
+        // size (pixels) of the (square) image
+        unsigned int size;
+    };
+
+    /*
+     * Location of an image within an atlas.
+     *
+     * A slot is only valid until the next call to slot() which creates
+     * an image or to clear(): creating an image can evict other images
+     * or start over with new pages. Draw it right away.
+     *
+     * `pixmap` is `nullptr` if the image is larger than the pages.
+     */
+    struct Slot
+    {
+        const QPixmap *pixmap;
+        QRect rect;
+    };
+
+public:
+    /*
+     * Builds an atlas of which the pages are `pageSize`×`pageSize`
+     * pixels and use at most `maxBytes` bytes in total.
+     *
+     * If a single page of `pageSize`×`pageSize` pixels would exceed
+     * `maxBytes`, then the pages are smaller.
+     *
+     * `devicePixelRatio` is the device pixel ratio of the pages: the
+     * images are in device pixels.
+     */
+    explicit DynamicAtlas(std::size_t maxBytes, int pageSize = 1024,
+                          qreal devicePixelRatio = 1.);
+
+    /*
+     * Returns the slot of the image having the key `key`, calling
+     * `createImage()` to create it (square image of `key.size` pixels)
+     * if the atlas doesn't have it.
+     *
+     * See `Slot` for how long the returned slot remains valid.
+     */
+    template <typename CreateImageFuncT>
+    Slot slot(const Key& key, CreateImageFuncT&& createImage)
+    {
+        const auto it = _entries.find(key);
+
+        if (it != std::end(_entries)) {
+            // most recently used
+            _lru.splice(std::end(_lru), _lru, it->second.lruIt);
+            return it->second.slot;
+        }
+
+        return this->_insert(key, createImage());
+    }
+
+    // draws the image of `slot` with its top-left corner at `pos`
+    static void draw(QPainter& painter, const QPoint& pos, const Slot& slot)
+    {
+        if (slot.pixmap) {
+            painter.drawPixmap(pos, *slot.pixmap, slot.rect);
+        }
+    }
+
+    void clear();
+
+    std::size_t maxBytes() const noexcept
+    {
+        return _maxBytes;
+    }
+
+    // bytes currently used by the pages
+    std::size_t bytes() const noexcept;
+
+    std::size_t imageCount() const noexcept
+    {
+        return _entries.size();
+    }
+
+private:
+    struct _KeyHash
+    {
+        std::size_t operator()(const Key& key) const noexcept
+        {
+            auto hash = std::hash<const Emoji *> {}(key.emoji);
+
+            hash ^= std::hash<unsigned int> {}(key.variant) + 0x9e3779b9 +
+                    (hash << 6) + (hash >> 2);
+            hash ^= std::hash<unsigned int> {}(key.size) + 0x9e3779b9 +
+                    (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+
+    struct _Shelf
+    {
+        int y;
+        int height;
+        int nextX;
+    };
+
+    struct _Page
+    {
+        QPixmap pixmap;
+        std::vector<_Shelf> shelves;
+        int nextShelfY = 0;
+    };
+
+    struct _Entry
+    {
+        Slot slot;
+        std::list<Key>::iterator lruIt;
+    };
+
+private:
+    Slot _insert(const Key& key, const QImage& image);
+    bool _allocRect(int size, Slot& slot);
+    bool _allocRectInPage(_Page& page, int size, QRect& rect);
+    bool _evictForSize(int size, Slot& slot);
+    std::size_t _pageBytes() const noexcept;
+    static int _pageSizeForMaxBytes(int pageSize, std::size_t maxBytes);
+
+private:
+    const std::size_t _maxBytes;
+    const int _pageSize;
+    const qreal _devicePixelRatio;
+    std::vector<std::unique_ptr<_Page>> _pages;
+    std::unordered_map<Key, _Entry, _KeyHash> _entries;
+
+    // keys, least recently used first
+    std::list<Key> _lru;
+};
+
+} // namespace jome
+
+#endif // _JOME_DYNAMIC_ATLAS_HPP
@@ -6,8 +6,13 @@
  */
 
 #include <fstream>
+#include <sstream>
 #include <cstdlib>
+#include <cctype>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <boost/algorithm/string.hpp>
 
 #include "emoji-db.hpp"
@@ -18,11 +23,14 @@ namespace jome {
 
 Emoji::Emoji(const std::string& str, const std::string& name,
              std::unordered_set<std::string>&& keywords,
-             const bool hasSkinToneSupport) :
+             const bool hasSkinToneSupport, const std::size_t index,
+             const EmojiPack * const pack) :
     _str {str},
     _name {name},
     _keywords {std::move(keywords)},
-    _hasSkinToneSupport {hasSkinToneSupport}
+    _hasSkinToneSupport {hasSkinToneSupport},
+    _index {index},
+    _pack {pack}
 {
 }
 
@@ -40,7 +48,7 @@ std::string Emoji::strWithSkinTone(SkinTone skinTone) const
 {
     assert(_hasSkinToneSupport);
 
-    const auto codepoints = this->codepoints();
+    const auto codepoints = this->codepointsWithSkinTone(skinTone);
 
     return utf8_string {std::begin(codepoints), std::end(codepoints)}.c_str();
 }
@@ -86,6 +94,25 @@ Emoji::Codepoints Emoji::codepointsWithSkinTone(SkinTone skinTone) const
     return codepoints;
 }
 
+std::string Emoji::fileStem(const SkinTone skinTone) const
+{
+    const auto codepoints = skinTone == SkinTone::NONE ? this->codepoints() :
+                            this->codepointsWithSkinTone(skinTone);
+    std::ostringstream ss;
+
+    ss << std::hex;
+
+    for (auto it = std::begin(codepoints); it != std::end(codepoints); ++it) {
+        if (it != std::begin(codepoints)) {
+            ss << '-';
+        }
+
+        ss << *it;
+    }
+
+    return ss.str();
+}
+
 Emoji::Codepoints Emoji::codepoints() const
 {
     Codepoints codepoints;
@@ -120,13 +147,53 @@ const std::string& EmojiCat::lcName() const
     return _lcName;
 }
 
-EmojiDb::EmojiDb(const std::string& dir) :
-    _emojisPngPath {dir + '/' + "emojis.png"}
+EmojiPack::EmojiPack(const std::string& dir) :
+    _dir {dir}
+{
+    // default name: last component of the directory
+    const auto end = dir.find_last_not_of('/');
+
+    if (end != std::string::npos) {
+        const auto slashPos = dir.rfind('/', end);
+        const auto begin = slashPos == std::string::npos ? 0 : slashPos + 1;
+
+        _name = dir.substr(begin, end + 1 - begin);
+    }
+}
+
+EmojiDb::EmojiDb(const std::string& dir,
+                 const std::vector<std::string>& packDirs) :
+    _dir {dir}
 {
     this->_createEmojis(dir);
     this->_createCats(dir);
-    this->_setRecentEmojisCatFromSettings();
+
+    for (const auto& packDir : packDirs) {
+        this->_createPack(packDir);
+    }
+
+    _emojiFindGens.resize(_emojis.size());
+    this->_setFrecencyFromSettings();
+    this->_updateRecentEmojisCat();
     this->_createEmojiPngLocations(dir);
+    this->_createFindThreadPool();
+}
+
+std::string EmojiDb::emojisPngPath(const unsigned int emojiSize) const
+{
+    if (emojiSize == 32) {
+        return _dir + '/' + "emojis.png";
+    }
+
+    return _dir + "/emojis-" + std::to_string(emojiSize) + ".png";
+}
+
+std::string EmojiDb::skinTonePngPath(const Emoji& emoji,
+                                     const Emoji::SkinTone skinTone,
+                                     const unsigned int emojiSize) const
+{
+    return _dir + "/skin-tones-" + std::to_string(emojiSize) + '/' +
+           emoji.fileStem(skinTone) + ".png";
 }
 
 json::JSON EmojiDb::_loadJson(const std::string& dir, const std::string& file)
@@ -153,26 +220,32 @@ void EmojiDb::_createEmojis(const std::string& dir)
             keywords.insert(kw.ToString());
         }
 
-        auto emoji = std::make_unique<const Emoji>(emojiStr,
-                                                   nameJson.ToString(),
-                                                   std::move(keywords),
-                                                   hasSkinToneSupport);
-
-        for (const auto& keyword : emoji->keywords()) {
-            _keywords.insert(keyword);
+        this->_addEmoji(std::make_unique<const Emoji>(emojiStr,
+                                                      nameJson.ToString(),
+                                                      std::move(keywords),
+                                                      hasSkinToneSupport,
+                                                      _emojis.size()));
+    }
+}
 
-            auto it = _keywordEmojis.find(keyword);
+void EmojiDb::_addEmoji(std::unique_ptr<const Emoji> emoji)
+{
+    for (const auto& keyword : emoji->keywords()) {
+        _keywords.insert(keyword);
 
-            if (it == std::end(_keywordEmojis)) {
-                it = _keywordEmojis.insert(std::make_pair(keyword,
-                                                          decltype(_keywordEmojis)::mapped_type {})).first;
-            }
+        auto it = _keywordEmojis.find(keyword);
 
-            it->second.insert(emoji.get());
+        if (it == std::end(_keywordEmojis)) {
+            it = _keywordEmojis.insert(std::make_pair(keyword,
+                                                      decltype(_keywordEmojis)::mapped_type {})).first;
         }
 
-        _emojis[emojiStr] = std::move(emoji);
+        it->second.insert(emoji.get());
     }
+
+    const auto& str = emoji->str();
+
+    _emojis[str] = std::move(emoji);
 }
 
 void EmojiDb::_createCats(const std::string& dir)
@@ -190,9 +263,12 @@ void EmojiDb::_createCats(const std::string& dir)
         std::vector<const Emoji *> emojis;
 
         for (const auto& emojiJson : emojisJson.ArrayRange()) {
-            const auto emojiStr = emojiJson.ToString();
+            // `find()`: `operator[]` would add a null emoji
+            const auto it = _emojis.find(emojiJson.ToString());
 
-            emojis.push_back(_emojis[emojiStr].get());
+            if (it != std::end(_emojis)) {
+                emojis.push_back(it->second.get());
+            }
         }
 
         auto cat = std::make_unique<EmojiCat>(idJson.ToString(),
@@ -203,105 +279,353 @@ void EmojiDb::_createCats(const std::string& dir)
     }
 }
 
+// splits `line` into space-separated `fields`
+static void splitFields(const std::string& line, std::vector<std::string>& fields)
+{
+    fields.clear();
+
+    std::size_t begin = 0;
+
+    while (begin < line.size()) {
+        const auto end = std::min(line.find(' ', begin), line.size());
+
+        if (end > begin) {
+            fields.emplace_back(line, begin, end - begin);
+        }
+
+        begin = end + 1;
+    }
+}
+
+void EmojiDb::_createPack(const std::string& dir)
+{
+    const auto manifestPath = dir + "/manifest.txt";
+    std::ifstream f {manifestPath};
+
+    if (!f) {
+        std::cerr << "Cannot open emoji pack manifest `" << manifestPath <<
+                     "`: skipping." << std::endl;
+        return;
+    }
+
+    auto pack = std::make_unique<EmojiPack>(dir);
+
+    // categories of this pack, by name
+    std::unordered_map<std::string, EmojiCat *> cats;
+    std::string catName;
+    std::string line;
+    std::vector<std::string> fields;
+
+    /*
+     * This is the whole cost of a pack at startup: don't touch the
+     * shards here.
+     */
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line[0] == '@') {
+            // directive: the value is the rest of the line
+            const auto spacePos = std::min(line.find(' '), line.size());
+            const auto directive = line.substr(1, spacePos - 1);
+            const auto value = spacePos < line.size() ?
+                               line.substr(spacePos + 1) : std::string {};
+
+            if (directive == "name") {
+                pack->_name = value;
+            } else if (directive == "image-size") {
+                pack->_imageSize = static_cast<unsigned int>(std::strtoul(value.c_str(),
+                                                                          nullptr, 10));
+            } else if (directive == "shard") {
+                pack->_shardPaths.push_back(dir + '/' + value);
+            } else if (directive == "cat") {
+                catName = value;
+            }
+
+            continue;
+        }
+
+        splitFields(line, fields);
+
+        if (fields.size() < 4) {
+            continue;
+        }
+
+        const EmojiPackLocation loc {
+            static_cast<unsigned int>(std::strtoul(fields[0].c_str(), nullptr, 10)),
+            static_cast<unsigned int>(std::strtoul(fields[1].c_str(), nullptr, 10)),
+            static_cast<unsigned int>(std::strtoul(fields[2].c_str(), nullptr, 10)),
+        };
+        const auto& name = fields[3];
+        const auto str = ':' + name + ':';
+
+        if (loc.shardIndex >= pack->_shardPaths.size() || _emojis.count(str) > 0) {
+            continue;
+        }
+
+        /*
+         * Like `create.py`: the lowercase name is also a keyword.
+         *
+         * Lowercase in place, without a locale: with tens of thousands
+         * of entries, boost::algorithm::to_lower_copy() alone would
+         * take about a third of the load time of the pack.
+         */
+        std::unordered_set<std::string> keywords;
+
+        for (auto it = std::begin(fields) + 3; it != std::end(fields); ++it) {
+            auto keyword = *it;
+
+            for (auto& ch : keyword) {
+                ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            }
+
+            keywords.insert(std::move(keyword));
+        }
+
+        auto emoji = std::make_unique<const Emoji>(str, name,
+                                                   std::move(keywords), false,
+                                                   _emojis.size(), pack.get());
+
+        // category (created on its first emoji)
+        const auto& emojiCatName = catName.empty() ? pack->_name : catName;
+        auto& cat = cats[emojiCatName];
+
+        if (!cat) {
+            _cats.push_back(std::make_unique<EmojiCat>("pack:" + pack->_name +
+                                                       ':' + emojiCatName,
+                                                       emojiCatName));
+            cat = _cats.back().get();
+        }
+
+        cat->emojis().push_back(emoji.get());
+        _emojiPackLocations[emoji.get()] = loc;
+        this->_addEmoji(std::move(emoji));
+    }
+
+    _packs.push_back(std::move(pack));
+}
+
 void EmojiDb::_createEmojiPngLocations(const std::string& dir)
 {
     const auto pngLocationsJson = this->_loadJson(dir,
                                                   "emojis-png-locations.json");
 
     for (const auto& keyValPair : pngLocationsJson.ObjectRange()) {
-        const auto& emojiStr = keyValPair.first;
+        const auto it = _emojis.find(keyValPair.first);
         const auto& valJson = keyValPair.second;
 
-        _emojiPngLocations[_emojis[emojiStr].get()] = {
+        if (it == std::end(_emojis)) {
+            continue;
+        }
+
+        _emojiPngLocations[it->second.get()] = {
             static_cast<unsigned int>(valJson.at(0).ToInt()),
             static_cast<unsigned int>(valJson.at(1).ToInt())
         };
     }
 }
 
-void EmojiDb::findEmojis(const std::string& cat, const std::string& needlesStr,
-                         std::vector<const Emoji *>& results) const
+void EmojiDb::_newFindGen() const
 {
-    std::string catTrimmed {cat};
+    ++_findGen;
 
-    // split needles string into individual needles
-    _tmpNeedles.clear();
-    boost::split(_tmpNeedles, needlesStr, boost::is_any_of(" "));
-
-    if (_tmpNeedles.empty()) {
-        // nothing to search
-        return;
+    if (_findGen == 0) {
+        // wrapped: forget all the previous generations
+        std::fill(std::begin(_emojiFindGens), std::end(_emojiFindGens), 0);
+        _findGen = 1;
     }
+}
 
-    // trim category
-    boost::trim(catTrimmed);
-
-    // this is to avoid duplicate entries in `results`
-    _tmpFoundEmojis.clear();
+void EmojiDb::_updateFindEntries()
+{
+    _findEntries.clear();
 
-    for (const auto& cat : _cats) {
-        if (!catTrimmed.empty() && cat->lcName().find(catTrimmed) == std::string::npos) {
-            // we don't want to search this category
-            continue;
+    for (auto catIndex = 0U; catIndex < _cats.size(); ++catIndex) {
+        for (const auto emoji : _cats[catIndex]->emojis()) {
+            _findEntries.push_back({emoji, catIndex});
         }
+    }
+}
 
-        for (const auto& emoji : cat->emojis()) {
-            bool select = true;
+void EmojiDb::_createFindThreadPool()
+{
+    const auto shardCount = (_findEntries.size() + _findShardSize - 1) /
+                            _findShardSize;
+    auto threadCount = 0U;
+
+    if (shardCount >= 4) {
+        // the calling thread also matches shards
+        threadCount = std::min(std::max(std::thread::hardware_concurrency(),
+                                        2U), 4U) - 1;
+        _findThreadPool = std::make_unique<ThreadPool>(threadCount);
+    }
 
-            for (const auto& keyword : emoji->keywords()) {
-                select = true;
+    _tmpCatMatches.resize(_cats.size());
+    _tmpShardMatches.resize(threadCount + 1);
 
-                for (const auto& needle : _tmpNeedles) {
-                    if (needle.empty()) {
-                        continue;
-                    }
+    for (auto& shardMatches : _tmpShardMatches) {
+        shardMatches.reserve(_findShardSize);
+    }
+}
 
-                    if (keyword.find(needle) == std::string::npos) {
-                        // this keyword does not this needle
-                        select = false;
-                        break;
-                    }
-                }
+void EmojiDb::_setTmpCatMatches(const EmojiQuery& query) const
+{
+    for (auto catIndex = 0U; catIndex < _cats.size(); ++catIndex) {
+        _tmpCatMatches[catIndex] = this->_catMatchesQuery(*_cats[catIndex],
+                                                          query);
+    }
+}
 
-                if (select) {
-                    break;
-                }
+std::size_t EmojiDb::_matchFindEntries(const EmojiQuery& query,
+                                       const std::size_t begin) const
+{
+    const auto shardCount = std::min(_tmpShardMatches.size(),
+                                     (_findEntries.size() - begin +
+                                      _findShardSize - 1) / _findShardSize);
+    auto matchShard = [this, &query, begin](const std::size_t shardIndex) {
+        auto& matches = _tmpShardMatches[shardIndex];
+        const auto shardBegin = begin + shardIndex * _findShardSize;
+        const auto shardEnd = std::min(shardBegin + _findShardSize,
+                                       _findEntries.size());
+
+        matches.clear();
+
+        for (auto entryIndex = shardBegin; entryIndex < shardEnd; ++entryIndex) {
+            const auto& entry = _findEntries[entryIndex];
+
+            if (_tmpCatMatches[entry.catIndex] &&
+                    this->_emojiMatchesQuery(*entry.emoji, query)) {
+                matches.push_back(entryIndex);
             }
+        }
+    };
 
-            if (!select) {
-                // not selected: next emoji
-                continue;
-            }
+    if (_findThreadPool && shardCount > 1) {
+        _findThreadPool->run(shardCount, matchShard);
+    } else {
+        for (auto shardIndex = 0U; shardIndex < shardCount; ++shardIndex) {
+            matchShard(shardIndex);
+        }
+    }
 
-            if (_tmpFoundEmojis.find(emoji) != std::end(_tmpFoundEmojis)) {
-                // we already have it: next emoji
-                continue;
+    _tmpBatchShardCount = shardCount;
+    return std::min(begin + shardCount * _findShardSize, _findEntries.size());
+}
+
+bool EmojiDb::_catMatchesQuery(const EmojiCat& cat,
+                               const EmojiQuery& query) const
+{
+    return query.cat().empty() ||
+           cat.lcName().find(query.cat()) != std::string::npos;
+}
+
+bool EmojiDb::_emojiMatchesQuery(const Emoji& emoji,
+                                 const EmojiQuery& query) const
+{
+    bool select = true;
+
+    for (const auto& keyword : emoji.keywords()) {
+        select = true;
+
+        for (auto needleIt = query.needlesBegin();
+                needleIt != query.needlesEnd(); ++needleIt) {
+            if (keyword.find(*needleIt) == std::string::npos) {
+                // this keyword does not this needle
+                select = false;
+                break;
             }
+        }
 
-            results.push_back(emoji);
-            _tmpFoundEmojis.insert(emoji);
+        if (select) {
+            break;
         }
     }
+
+    return select;
+}
+
+void EmojiDb::findEmojis(const EmojiQuery& query, EmojiFindPos& pos,
+                         std::vector<const Emoji *>& results,
+                         const std::size_t maxCount) const
+{
+    if (maxCount == 0) {
+        return;
+    }
+
+    std::size_t count = 0;
+
+    this->findEmojis(query, pos,
+                     [&results, &count, maxCount](const Emoji& emoji) {
+        results.push_back(&emoji);
+        ++count;
+        return count < maxCount;
+    });
+}
+
+static EmojiFrecency::Time frecencyNow()
+{
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+
+    return std::chrono::duration_cast<std::chrono::seconds>(now).count();
 }
 
 void EmojiDb::_updateSettings()
 {
-    QList<QVariant> emojiList;
+    QString frecencyStr;
 
-    for (const auto emoji : _recentEmojisCat->emojis()) {
-        const auto emojiStr = QString::fromStdString(emoji->str());
+    for (const auto& emojiStrEmojiPair : _emojis) {
+        const auto& emoji = *emojiStrEmojiPair.second;
 
-        emojiList.append(emojiStr);
+        if (!_frecency->isUsed(emoji.index())) {
+            continue;
+        }
+
+        frecencyStr += QString::fromStdString(emoji.str());
+        frecencyStr += ' ';
+        frecencyStr += QString::number(_frecency->rank(emoji.index()), 'g', 17);
+        frecencyStr += '\n';
     }
 
-    _settings.setValue("recent-emojis", emojiList);
+    _settings.setValue("emoji-frecency", frecencyStr);
 }
 
-void EmojiDb::_setRecentEmojisCatFromSettings()
+void EmojiDb::_setFrecencyFromSettings()
 {
-    assert(_recentEmojisCat);
-    _recentEmojisCat->emojis().clear();
+    _frecency = std::make_unique<EmojiFrecency>(_emojis.size());
+
+    if (_settings.contains("emoji-frecency")) {
+        // one `EMOJI RANK` line per used emoji
+        const auto frecencyStr = _settings.value("emoji-frecency").toString();
+
+        for (const auto& line : frecencyStr.splitRef('\n', QString::SkipEmptyParts)) {
+            const auto spaceIndex = line.indexOf(' ');
 
+            if (spaceIndex < 0) {
+                continue;
+            }
+
+            const auto it = _emojis.find(line.left(spaceIndex).toUtf8().constData());
+
+            if (it == std::end(_emojis)) {
+                continue;
+            }
+
+            bool ok;
+            const auto rank = line.mid(spaceIndex + 1).toDouble(&ok);
+
+            if (ok) {
+                _frecency->rank(it->second->index(), rank);
+            }
+        }
+
+        return;
+    }
+
+    /*
+     * No frecency yet: use the previous list of recent emojis, most
+     * recent first, to start with the same order.
+     */
     const auto recentEmojisVar = _settings.value("recent-emojis");
 
     if (!recentEmojisVar.canConvert<QList<QVariant>>()) {
@@ -309,6 +633,7 @@ void EmojiDb::_setRecentEmojisCatFromSettings()
     }
 
     const auto recentEmojisList = recentEmojisVar.toList();
+    auto time = frecencyNow();
 
     for (const auto& emojiStrVar : recentEmojisList) {
         if (!emojiStrVar.canConvert<QString>()) {
@@ -322,36 +647,73 @@ void EmojiDb::_setRecentEmojisCatFromSettings()
             continue;
         }
 
-        _recentEmojisCat->emojis().push_back(it->second.get());
+        _frecency->addUse(it->second->index(), time);
+        --time;
     }
 }
 
-void EmojiDb::addRecentEmoji(const Emoji& emoji)
+void EmojiDb::_updateRecentEmojisCat()
 {
     assert(_recentEmojisCat);
 
+    constexpr auto maxRecentEmojis = 30U;
+
+    /*
+     * Keep the most frecent emojis with a bounded min-heap (the top of
+     * the heap is the least frecent of the kept emojis) instead of
+     * sorting all the emojis.
+     */
     auto& emojis = _recentEmojisCat->emojis();
+    const auto moreFrecent = [this](const Emoji * const left,
+                                    const Emoji * const right) {
+        const auto leftRank = _frecency->rank(left->index());
+        const auto rightRank = _frecency->rank(right->index());
+
+        /*
+         * `_emojis` has no stable order: break ties with the database
+         * order so that the Recent category is the same from one run
+         * to the other.
+         */
+        if (leftRank != rightRank) {
+            return leftRank > rightRank;
+        }
 
-    while (true) {
-        auto existingIt = std::find(std::begin(emojis), std::end(emojis),
-                                    &emoji);
+        return left->index() < right->index();
+    };
 
-        if (existingIt == std::end(emojis)) {
-            break;
+    emojis.clear();
+
+    for (const auto& emojiStrEmojiPair : _emojis) {
+        const auto emoji = emojiStrEmojiPair.second.get();
+
+        if (!_frecency->isUsed(emoji->index())) {
+            continue;
         }
 
-        emojis.erase(existingIt);
+        if (emojis.size() < maxRecentEmojis) {
+            emojis.push_back(emoji);
+            std::push_heap(std::begin(emojis), std::end(emojis), moreFrecent);
+        } else if (moreFrecent(emoji, emojis.front())) {
+            std::pop_heap(std::begin(emojis), std::end(emojis), moreFrecent);
+            emojis.back() = emoji;
+            std::push_heap(std::begin(emojis), std::end(emojis), moreFrecent);
+        }
     }
 
-    emojis.insert(std::begin(emojis), &emoji);
+    // most frecent first
+    std::sort_heap(std::begin(emojis), std::end(emojis), moreFrecent);
+    this->_updateFindEntries();
+}
 
-    constexpr auto maxRecentEmojis = 30U;
+void EmojiDb::addRecentEmoji(const Emoji& emoji)
+{
+    _frecency->addUse(emoji.index(), frecencyNow());
+    this->_updateRecentEmojisCat();
+    this->_updateSettings();
 
-    if (emojis.size() > maxRecentEmojis) {
-        emojis.resize(maxRecentEmojis);
+    if (_recentEmojisChangedFunc) {
+        _recentEmojisChangedFunc(*_recentEmojisCat);
     }
-
-    this->_updateSettings();
 }
 
 } // namespace jome
@@ -13,12 +13,18 @@
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <functional>
 #include <QSettings>
 
 #include "simple-json.hpp"
+#include "emoji-query.hpp"
+#include "emoji-frecency.hpp"
+#include "thread-pool.hpp"
 
 namespace jome {
 
+class EmojiPack;
+
 class Emoji
 {
 public:
@@ -38,12 +44,19 @@ public:
 public:
     explicit Emoji(const std::string& str, const std::string& name,
                    std::unordered_set<std::string>&& keywords,
-                   bool hasSkinToneSupport);
+                   bool hasSkinToneSupport, std::size_t index,
+                   const EmojiPack *pack = nullptr);
     Codepoints codepoints() const;
     Codepoints codepointsWithSkinTone(SkinTone skinTone) const;
     std::string strWithSkinTone(SkinTone skinTone) const;
     const std::string& lcName() const;
 
+    /*
+     * Dash-separated hexadecimal codepoints of this emoji with the
+     * skin tone `skinTone`, as found in the names of its image files.
+     */
+    std::string fileStem(SkinTone skinTone = SkinTone::NONE) const;
+
     const std::string& str() const noexcept
     {
         return _str;
@@ -64,12 +77,29 @@ public:
         return _hasSkinToneSupport;
     }
 
+    /*
+     * Index of this emoji within its database, from 0 to the number
+     * of emojis of this database, excluded.
+     */
+    std::size_t index() const noexcept
+    {
+        return _index;
+    }
+
+    // custom emoji pack of this emoji (`nullptr` for a Unicode emoji)
+    const EmojiPack *pack() const noexcept
+    {
+        return _pack;
+    }
+
 private:
     const std::string _str;
     const std::string _name;
     mutable std::string _lcName;
     const std::unordered_set<std::string> _keywords;
     const bool _hasSkinToneSupport;
+    const std::size_t _index;
+    const EmojiPack * const _pack;
 };
 
 class EmojiCat
@@ -113,19 +143,215 @@ struct EmojisPngLocation
     unsigned int y;
 };
 
+/*
+ * Custom emoji pack: a directory containing a `manifest.txt` file and
+ * one or more atlas shards, PNG files containing the square images of
+ * the emojis of the pack.
+ *
+ * The manifest has one entry per line:
+ *
+ * `@name NAME`::
+ *     Name of the pack, which is also the default category name
+ *     (default: name of the directory).
+ *
+ * `@image-size SIZE`::
+ *     Size (pixels) of an emoji image within the shards (default: 32).
+ *
+ * `@shard FILE`::
+ *     Path of the next shard (index 0, then 1, and so on), relative to
+ *     the pack directory.
+ *
+ * `@cat NAME`::
+ *     Category of the following emojis.
+ *
+ * `SHARD X Y NAME [KEYWORD]...`::
+ *     Emoji named `NAME` (no spaces) of which the image is at (`X`,
+ *     `Y`) within the shard `SHARD`, with additional keywords.
+ *
+ * Lines starting with `#` are comments.
+ *
+ * The string of a pack emoji, what jome outputs, is `:NAME:`.
+ *
+ * An emoji database only reads the manifest: EmojiImages loads a shard
+ * the first time it draws one of its emojis.
+ */
+class EmojiPack
+{
+    friend class EmojiDb;
+
+public:
+    explicit EmojiPack(const std::string& dir);
+
+    const std::string& dir() const noexcept
+    {
+        return _dir;
+    }
+
+    const std::string& name() const noexcept
+    {
+        return _name;
+    }
+
+    unsigned int imageSize() const noexcept
+    {
+        return _imageSize;
+    }
+
+    // paths of the shards (indexed by shard index)
+    const std::vector<std::string>& shardPaths() const noexcept
+    {
+        return _shardPaths;
+    }
+
+private:
+    const std::string _dir;
+    std::string _name;
+    unsigned int _imageSize = 32;
+    std::vector<std::string> _shardPaths;
+};
+
+struct EmojiPackLocation
+{
+    // index of the shard within its pack
+    unsigned int shardIndex;
+
+    // position of the image within the shard (pixels)
+    unsigned int x;
+    unsigned int y;
+};
+
+/*
+ * Position of an ongoing search within an emoji database.
+ *
+ * Pass the same position to successive calls to EmojiDb::findEmojis()
+ * with the same query to continue the search where the previous call
+ * stopped. Call reset() to start a new search.
+ */
+class EmojiFindPos
+{
+    friend class EmojiDb;
+
+public:
+    void reset() noexcept
+    {
+        _entryIndex = 0;
+        _isDone = false;
+    }
+
+    bool isDone() const noexcept
+    {
+        return _isDone;
+    }
+
+private:
+    std::size_t _entryIndex = 0;
+    bool _isDone = false;
+};
+
 class EmojiDb
 {
 public:
-    explicit EmojiDb(const std::string& dir);
-    void findEmojis(const std::string& cat, const std::string& needles,
-                    std::vector<const Emoji *>& results) const;
+    // called when the emojis of the Recent category change
+    using RecentEmojisChangedFunc = std::function<void (const EmojiCat&)>;
+
+public:
+    /*
+     * Creates an emoji database from the data directory `dir` and
+     * merges the custom emoji packs of the directories `packDirs`,
+     * each one with its own categories after the Unicode emoji ones.
+     *
+     * When two emojis have the same string, the first one wins.
+     */
+    explicit EmojiDb(const std::string& dir,
+                     const std::vector<std::string>& packDirs = {});
+    void findEmojis(const EmojiQuery& query, EmojiFindPos& pos,
+                    std::vector<const Emoji *>& results,
+                    std::size_t maxCount) const;
     void addRecentEmoji(const Emoji& emoji);
 
-    const std::string& emojisPngPath() const noexcept
+    void recentEmojisChangedFunc(RecentEmojisChangedFunc func)
     {
-        return _emojisPngPath;
+        _recentEmojisChangedFunc = std::move(func);
     }
 
+    /*
+     * Calls `func()` with each emoji, in display order, which is part
+     * of a category of which the name contains the category of `query`
+     * and which has a keyword containing all the needles of `query`,
+     * starting at `pos`, until `func()` returns `false`.
+     *
+     * An emoji which is part of more than one category is only
+     * found once during a given search.
+     *
+     * A query with extra needles (see EmojiQuery::hasExtraNeedles())
+     * finds nothing.
+     */
+    template <typename FuncT>
+    void findEmojis(const EmojiQuery& query, EmojiFindPos& pos,
+                    FuncT&& func) const
+    {
+        if (pos._isDone) {
+            return;
+        }
+
+        if (query.hasExtraNeedles()) {
+            pos._isDone = true;
+            return;
+        }
+
+        if (pos._entryIndex == 0) {
+            // new search
+            this->_newFindGen();
+        }
+
+        this->_setTmpCatMatches(query);
+
+        while (pos._entryIndex < _findEntries.size()) {
+            // match the next batch of shards, possibly in parallel
+            const auto batchEnd = this->_matchFindEntries(query,
+                                                          pos._entryIndex);
+
+            // merge the matches of each shard in display order
+            for (auto shardI = 0U; shardI < _tmpBatchShardCount; ++shardI) {
+                for (const auto entryIndex : _tmpShardMatches[shardI]) {
+                    const auto emoji = _findEntries[entryIndex].emoji;
+                    auto& emojiFindGen = _emojiFindGens[emoji->index()];
+
+                    if (emojiFindGen == _findGen) {
+                        // we already have it: next emoji
+                        continue;
+                    }
+
+                    emojiFindGen = _findGen;
+
+                    if (!func(*emoji)) {
+                        pos._entryIndex = entryIndex + 1;
+                        return;
+                    }
+                }
+            }
+
+            pos._entryIndex = batchEnd;
+        }
+
+        pos._isDone = true;
+    }
+
+    /*
+     * Path of the PNG file containing all the emojis in their
+     * `emojiSize`×`emojiSize` form (see EmojiImages::sizes).
+     */
+    std::string emojisPngPath(unsigned int emojiSize = 32) const;
+
+    /*
+     * Path of the PNG file containing the `emojiSize`×`emojiSize` image
+     * of `emoji` with the skin tone `skinTone`.
+     *
+     * This file doesn't necessarily exist.
+     */
+    std::string skinTonePngPath(const Emoji& emoji, Emoji::SkinTone skinTone,
+                                unsigned int emojiSize = 32) const;
+
     const std::vector<std::unique_ptr<EmojiCat>>& cats() const noexcept
     {
         return _cats;
@@ -151,29 +377,98 @@ public:
         return _emojiPngLocations;
     }
 
+    const std::vector<std::unique_ptr<EmojiPack>>& packs() const noexcept
+    {
+        return _packs;
+    }
+
+    // location of the image of `emoji`, which is part of a pack
+    const EmojiPackLocation& emojiPackLocation(const Emoji& emoji) const
+    {
+        return _emojiPackLocations.at(&emoji);
+    }
+
     const std::unordered_set<const Emoji *>& emojisForKeyword(const std::string& keyword) const
     {
         return _keywordEmojis.find(keyword)->second;
     }
 
+    const EmojiFrecency& frecency() const noexcept
+    {
+        return *_frecency;
+    }
+
+    const EmojiCat& recentEmojisCat() const noexcept
+    {
+        return *_recentEmojisCat;
+    }
+
+private:
+    // emoji of a category, in display order
+    struct _FindEntry
+    {
+        const Emoji *emoji;
+        std::size_t catIndex;
+    };
+
+    // number of find entries per search shard
+    static constexpr std::size_t _findShardSize = 2048;
+
 private:
     json::JSON _loadJson(const std::string& dir, const std::string& file);
     void _createEmojis(const std::string& dir);
     void _createCats(const std::string& dir);
+    void _createPack(const std::string& dir);
+    void _addEmoji(std::unique_ptr<const Emoji> emoji);
     void _createEmojiPngLocations(const std::string& dir);
     void _updateSettings();
-    void _setRecentEmojisCatFromSettings();
+    void _setFrecencyFromSettings();
+    void _updateRecentEmojisCat();
+    void _updateFindEntries();
+    void _createFindThreadPool();
+    void _newFindGen() const;
+    void _setTmpCatMatches(const EmojiQuery& query) const;
+    std::size_t _matchFindEntries(const EmojiQuery& query,
+                                  std::size_t begin) const;
+    bool _catMatchesQuery(const EmojiCat& cat, const EmojiQuery& query) const;
+    bool _emojiMatchesQuery(const Emoji& emoji, const EmojiQuery& query) const;
 
 private:
-    const std::string _emojisPngPath;
+    const std::string _dir;
     std::vector<std::unique_ptr<EmojiCat>> _cats;
     std::unordered_map<std::string, std::unique_ptr<const Emoji>> _emojis;
     std::unordered_map<std::string, std::unordered_set<const Emoji *>> _keywordEmojis;
     std::unordered_set<std::string> _keywords;
     std::unordered_map<const Emoji *, EmojisPngLocation> _emojiPngLocations;
-    mutable std::vector<std::string> _tmpNeedles;
-    mutable std::unordered_set<const Emoji *> _tmpFoundEmojis;
+    std::vector<std::unique_ptr<EmojiPack>> _packs;
+    std::unordered_map<const Emoji *, EmojiPackLocation> _emojiPackLocations;
+
+    /*
+     * Generation of the last search which found a given emoji (indexed
+     * by emoji index), to avoid finding the same emoji twice during a
+     * search without allocating anything.
+     */
+    mutable std::vector<unsigned long> _emojiFindGens;
+    mutable unsigned long _findGen = 0;
+
+    // all the emojis of all the categories, in display order
+    std::vector<_FindEntry> _findEntries;
+
+    /*
+     * Thread pool to match the shards of `_findEntries` in parallel
+     * (only exists with enough shards).
+     */
+    std::unique_ptr<ThreadPool> _findThreadPool;
+
+    // whether or not each category matches the current query
+    mutable std::vector<char> _tmpCatMatches;
+
+    // matching find entry indexes of each shard of the current batch
+    mutable std::vector<std::vector<std::size_t>> _tmpShardMatches;
+    mutable std::size_t _tmpBatchShardCount = 0;
     EmojiCat *_recentEmojisCat = nullptr;
+    RecentEmojisChangedFunc _recentEmojisChangedFunc;
+    std::unique_ptr<EmojiFrecency> _frecency;
 
     // TODO: decouple this part from Qt
     QSettings _settings;
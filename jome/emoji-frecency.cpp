@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "emoji-frecency.hpp"
+
+namespace jome {
+
+EmojiFrecency::EmojiFrecency(const std::size_t emojiCount) :
+    _ranks(emojiCount, unusedRank())
+{
+}
+
+double EmojiFrecency::unusedRank() noexcept
+{
+    return -std::numeric_limits<double>::infinity();
+}
+
+void EmojiFrecency::addUse(const std::size_t index, const Time time)
+{
+    const auto timeRank = static_cast<double>(time) /
+                          static_cast<double>(halfLife);
+    auto& rank = _ranks[index];
+
+    /*
+     * Current score is 2^(rank - timeRank): add one use, then go back
+     * to the epoch.
+     */
+    rank = std::log2(std::exp2(rank - timeRank) + 1.) + timeRank;
+}
+
+double EmojiFrecency::score(const std::size_t index, const Time time) const
+{
+    const auto timeRank = static_cast<double>(time) /
+                          static_cast<double>(halfLife);
+
+    return std::exp2(_ranks[index] - timeRank);
+}
+
+} // namespace jome
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_EMOJI_FRECENCY_HPP
+#define _JOME_EMOJI_FRECENCY_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace jome {
+
+/*
+ * Frecency (frequency and recency) model of emoji uses.
+ *
+ * The score of an emoji is the sum, for each use, of
+ * 2^(-age / half-life).
+ *
+ * For each emoji, indexed by emoji index, this model only keeps the
+ * base-2 logarithm of this score as evaluated at the epoch (its rank).
+ * Ranks order emojis exactly like their current scores do, so ranking
+ * emojis doesn't need the current time and old uses never need to be
+ * decayed.
+ */
+class EmojiFrecency
+{
+public:
+    // seconds since the epoch
+    using Time = std::int64_t;
+
+public:
+    static constexpr Time halfLife = 7 * 24 * 3600;
+
+public:
+    explicit EmojiFrecency(std::size_t emojiCount);
+    void addUse(std::size_t index, Time time);
+    double score(std::size_t index, Time time) const;
+
+    bool isUsed(const std::size_t index) const noexcept
+    {
+        return _ranks[index] != unusedRank();
+    }
+
+    double rank(const std::size_t index) const noexcept
+    {
+        return _ranks[index];
+    }
+
+    void rank(const std::size_t index, const double rank) noexcept
+    {
+        _ranks[index] = rank;
+    }
+
+    std::size_t emojiCount() const noexcept
+    {
+        return _ranks.size();
+    }
+
+    static double unusedRank() noexcept;
+
+private:
+    std::vector<double> _ranks;
+};
+
+} // namespace jome
+
+#endif // _JOME_EMOJI_FRECENCY_HPP
@@ -5,28 +5,415 @@
  * of the MIT license. See the LICENSE file for details.
  */
 
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <QImage>
+#include <QFontInfo>
+#include <QFontMetrics>
+#include <QFontMetricsF>
+#include <QRawFont>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+
 #include "emoji-images.hpp"
 
 namespace jome {
 
-EmojiImages::EmojiImages(const EmojiDb& db)
+namespace {
+
+// enough for all the variants of a few hundred emojis at the largest size
+constexpr std::size_t atlasMaxBytes = 16 << 20;
+
+/*
+ * With a font or SVG files, all the emojis go through the atlas: enough
+ * for all of them at the smallest sizes so that scrolling back never
+ * rasterizes them again.
+ */
+constexpr std::size_t fullAtlasMaxBytes = 64 << 20;
+
+/*
+ * Maximum total size of the loaded pack shards: a shard is typically a
+ * 1024 x 1024 PNG file (4 MiB once decoded), so that's all the shards
+ * of packs of a few thousand emojis each, and enough for any screenful
+ * of find results. Evicting a shard which the next paint needs again
+ * means decoding its PNG file again.
+ */
+constexpr std::size_t packShardsMaxBytes = 128 << 20;
+
+std::size_t imageBytes(const QImage& image)
 {
-    this->_createPixmaps(db);
+    return static_cast<std::size_t>(image.bytesPerLine()) *
+           static_cast<std::size_t>(image.height());
 }
 
-void EmojiImages::_createPixmaps(const EmojiDb& db)
+} // namespace
+
+EmojiImages::EmojiImages(const EmojiDb& db, const unsigned int emojiSize,
+                         const qreal devicePixelRatio,
+                         const boost::optional<FontSource>& fontSource,
+                         const boost::optional<SvgSource>& svgSource) :
+    _emojiDb {&db}
 {
-    QImage image {QString::fromStdString(db.emojisPngPath())};
-    auto emojisPixmap = QPixmap::fromImage(std::move(image));
+    this->_loadPixmap(db, emojiSize, devicePixelRatio);
+    _atlasImageSize = _imageSize;
+
+    if (svgSource) {
+        // no need to stick to the available PNG sizes
+        _atlasImageSize = static_cast<unsigned int>(std::ceil(emojiSize *
+                                                              devicePixelRatio));
+
+        const auto cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+        QDir {}.mkpath(cacheDir);
+        _svgImages = std::make_unique<EmojiSvgImages>(db, svgSource->dir,
+                                                      _atlasImageSize,
+                                                      cacheDir + "/svg-" +
+                                                      QString::number(_atlasImageSize) +
+                                                      ".cache");
+    }
+
+    if (fontSource) {
+        this->_setFont(*fontSource);
+    }
+
+    _atlas = std::make_unique<DynamicAtlas>(_font || _svgImages ||
+                                            !db.packs().empty() ?
+                                            fullAtlasMaxBytes : atlasMaxBytes,
+                                            1024,
+                                            static_cast<qreal>(_atlasImageSize) /
+                                            emojiSize);
+
+    // emoji PNG locations are in base size pixels
+    const auto scale = _imageSize / sizes[0];
+
+    _emojiPixmapPositions.resize(db.emojis().size());
 
     for (const auto& emojiPngLocation : db.emojiPngLocations()) {
-        const auto emoji = emojiPngLocation.first;
         const auto& pngLoc = emojiPngLocation.second;
-        auto pixmap = std::make_unique<QPixmap>(emojisPixmap.copy(pngLoc.x,
-                                                                  pngLoc.y,
-                                                                  32, 32));
-        _emojiPixmaps[emoji] = std::move(pixmap);
+
+        _emojiPixmapPositions[emojiPngLocation.first->index()] = {
+            static_cast<int>(pngLoc.x * scale),
+            static_cast<int>(pngLoc.y * scale)
+        };
+    }
+}
+
+void EmojiImages::_setFont(const FontSource& fontSource)
+{
+    QFont font {fontSource.family};
+
+    font.setPixelSize(static_cast<int>(_atlasImageSize));
+
+    /*
+     * Qt silently substitutes another font for a missing one. Font
+     * family names are case-insensitive for Qt too.
+     */
+    if (QFontInfo {font}.family().compare(fontSource.family,
+                                          Qt::CaseInsensitive) != 0) {
+        std::cerr << "Cannot find font `" <<
+                     fontSource.family.toUtf8().constData() <<
+                     "`: using the emoji PNG file." << std::endl;
+        return;
+    }
+
+    _font = font;
+
+    if (!fontSource.diskCache) {
+        return;
     }
+
+    /*
+     * The `head` table holds the checksum of the whole font file and
+     * its modification date: a new version of the font gets its own
+     * cache directory.
+     */
+    QCryptographicHash hash {QCryptographicHash::Sha1};
+
+    hash.addData(fontSource.family.toUtf8());
+    hash.addData(QRawFont::fromFont(font).fontTable("head"));
+
+    const auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                     "/font-" + QString::fromLatin1(hash.result().toHex()) +
+                     '/' + QString::number(_atlasImageSize);
+
+    if (QDir {}.mkpath(dir)) {
+        _fontCacheDir = dir;
+    }
+}
+
+void EmojiImages::imagesReadyFunc(ImagesReadyFunc func)
+{
+    if (_svgImages) {
+        _svgImages->imagesReadyFunc(std::move(func));
+    }
+}
+
+void EmojiImages::trimCaches()
+{
+    _atlas->clear();
+    _packShards.clear();
+    _packShardsBytes = 0;
+}
+
+void EmojiImages::_loadPixmap(const EmojiDb& db, const unsigned int emojiSize,
+                              const qreal devicePixelRatio)
+{
+    const auto physEmojiSize = static_cast<unsigned int>(std::ceil(emojiSize *
+                                                                   devicePixelRatio));
+
+    // smallest size which doesn't need upscaling, or largest one
+    auto sizeIt = std::begin(sizes);
+
+    while (sizeIt + 1 != std::end(sizes) && *sizeIt < physEmojiSize) {
+        ++sizeIt;
+    }
+
+    /*
+     * Try the best size first, then the smaller ones: the data
+     * directory could be older than the larger emoji PNG files.
+     */
+    while (true) {
+        QImage image {QString::fromStdString(db.emojisPngPath(*sizeIt))};
+
+        if (!image.isNull() || sizeIt == std::begin(sizes)) {
+            _pixmap = QPixmap::fromImage(std::move(image));
+            _imageSize = *sizeIt;
+            break;
+        }
+
+        --sizeIt;
+    }
+
+    _pixmap.setDevicePixelRatio(static_cast<qreal>(_imageSize) / emojiSize);
+}
+
+void EmojiImages::drawEmoji(QPainter& painter, const QPoint& pos,
+                            const Emoji& emoji, Emoji::SkinTone skinTone)
+{
+    if (!emoji.hasSkinToneSupport()) {
+        skinTone = Emoji::SkinTone::NONE;
+    }
+
+    if (skinTone == Emoji::SkinTone::NONE && !emoji.pack() &&
+            ((!_font && !_svgImages) ||
+             (_svgImages && !_svgImages->isReady(emoji)))) {
+        this->drawEmoji(painter, pos, emoji);
+        return;
+    }
+
+    const DynamicAtlas::Key key {
+        &emoji, static_cast<unsigned int>(skinTone), _atlasImageSize
+    };
+
+    DynamicAtlas::draw(painter, pos, _atlas->slot(key, [&] {
+        return this->_image(emoji, skinTone);
+    }));
+}
+
+QImage EmojiImages::_image(const Emoji& emoji,
+                           const Emoji::SkinTone skinTone) const
+{
+    QImage image;
+
+    if (emoji.pack()) {
+        image = this->_packImage(emoji);
+    } else if (_svgImages) {
+        image = skinTone == Emoji::SkinTone::NONE ?
+                _svgImages->readyImage(emoji) :
+                _svgImages->image(emoji, skinTone);
+    } else if (_font) {
+        image = this->_fontImage(emoji, skinTone);
+    }
+
+    if (image.isNull()) {
+        image = skinTone == Emoji::SkinTone::NONE ?
+                this->_pixmapImage(emoji) :
+                this->_skinToneImage(emoji, skinTone);
+    }
+
+    const auto size = static_cast<int>(_atlasImageSize);
+
+    if (image.width() != size) {
+        /*
+         * PNG fallback with SVG files at a size which isn't available,
+         * or pack image.
+         */
+        image = image.scaled(size, size, Qt::IgnoreAspectRatio,
+                             Qt::SmoothTransformation);
+    }
+
+    return image;
+}
+
+QImage EmojiImages::_pixmapImage(const Emoji& emoji) const
+{
+    return _pixmap.copy(QRect {
+        _emojiPixmapPositions[emoji.index()],
+        QSize {static_cast<int>(_imageSize), static_cast<int>(_imageSize)}
+    }).toImage();
+}
+
+const QImage& EmojiImages::_packShardImage(const EmojiPack& pack,
+                                           const unsigned int shardIndex) const
+{
+    const auto it = std::find_if(std::begin(_packShards),
+                                 std::end(_packShards),
+                                 [&pack, shardIndex](const _PackShard& shard) {
+        return shard.pack == &pack && shard.index == shardIndex;
+    });
+
+    if (it != std::end(_packShards)) {
+        // most recently used first
+        std::rotate(std::begin(_packShards), it, it + 1);
+        return _packShards.front().image;
+    }
+
+    const auto& path = pack.shardPaths()[shardIndex];
+    QImage image {QString::fromStdString(path)};
+
+    if (image.isNull()) {
+        // keep the null image so as to not try to load it again
+        std::cerr << "Cannot load emoji pack shard `" << path << "`." <<
+                     std::endl;
+    }
+
+    const auto bytes = imageBytes(image);
+
+    // evict the least recently used shards, but always keep this one
+    while (!_packShards.empty() &&
+            _packShardsBytes + bytes > packShardsMaxBytes) {
+        _packShardsBytes -= imageBytes(_packShards.back().image);
+        _packShards.pop_back();
+    }
+
+    _packShardsBytes += bytes;
+    _packShards.insert(std::begin(_packShards),
+                       _PackShard {&pack, shardIndex, std::move(image)});
+    return _packShards.front().image;
+}
+
+QImage EmojiImages::_packImage(const Emoji& emoji) const
+{
+    const auto& pack = *emoji.pack();
+    const auto& loc = _emojiDb->emojiPackLocation(emoji);
+    const auto& shardImage = this->_packShardImage(pack, loc.shardIndex);
+    const auto size = static_cast<int>(pack.imageSize());
+    const QRect rect {
+        static_cast<int>(loc.x), static_cast<int>(loc.y), size, size
+    };
+
+    if (!shardImage.rect().contains(rect)) {
+        // missing shard or image: transparent
+        QImage image {size, size, QImage::Format_ARGB32_Premultiplied};
+
+        image.fill(Qt::transparent);
+        return image;
+    }
+
+    return shardImage.copy(rect);
+}
+
+QImage EmojiImages::_skinToneImage(const Emoji& emoji,
+                                   const Emoji::SkinTone skinTone) const
+{
+    QImage image {
+        QString::fromStdString(_emojiDb->skinTonePngPath(emoji, skinTone,
+                                                         _imageSize))
+    };
+
+    if (image.isNull() ||
+            image.size() != QSize {static_cast<int>(_imageSize),
+                                   static_cast<int>(_imageSize)}) {
+        /*
+         * Missing or unexpected variant: keep the emoji without a skin
+         * tone in the atlas so as to not try to load it again.
+         */
+        image = this->_pixmapImage(emoji);
+    }
+
+    return image;
+}
+
+bool EmojiImages::_fontHasEmoji(const Emoji::Codepoints& codepoints) const
+{
+    const QFontMetrics fontMetrics {*_font};
+
+    for (const auto codepoint : codepoints) {
+        // ZWJ, variation selectors, and tags aren't glyphs on their own
+        if (codepoint == 0x200d || codepoint == 0xfe0e || codepoint == 0xfe0f ||
+                (codepoint >= 0xe0020 && codepoint <= 0xe007f)) {
+            continue;
+        }
+
+        if (!fontMetrics.inFontUcs4(codepoint)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QImage EmojiImages::_fontImage(const Emoji& emoji,
+                               const Emoji::SkinTone skinTone) const
+{
+    QString cachePath;
+
+    if (!_fontCacheDir.isEmpty()) {
+        cachePath = _fontCacheDir + '/' +
+                    QString::fromStdString(emoji.fileStem(skinTone)) + ".png";
+
+        QImage image {cachePath};
+
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+
+    const auto codepoints = skinTone == Emoji::SkinTone::NONE ?
+                            emoji.codepoints() :
+                            emoji.codepointsWithSkinTone(skinTone);
+
+    if (!this->_fontHasEmoji(codepoints)) {
+        // fall back to the emoji PNG file
+        return {};
+    }
+
+    const auto str = QString::fromStdString(skinTone == Emoji::SkinTone::NONE ?
+                                            emoji.str() :
+                                            emoji.strWithSkinTone(skinTone));
+    const auto size = static_cast<int>(_atlasImageSize);
+    QImage image {size, size, QImage::Format_ARGB32_Premultiplied};
+
+    image.fill(Qt::transparent);
+
+    {
+        QPainter painter {&image};
+
+        /*
+         * Color emoji fonts usually have bitmap glyphs which are a bit
+         * wider than the pixel size: scale the glyph so that its bounding
+         * box fits the image, centered.
+         */
+        const auto bounds = QFontMetricsF {*_font}.boundingRect(str);
+        const auto scale = std::min(1., size / std::max(bounds.width(),
+                                                        bounds.height()));
+
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.setFont(*_font);
+        painter.translate(size / 2., size / 2.);
+        painter.scale(scale, scale);
+        painter.drawText(QPointF {-bounds.center().x(), -bounds.center().y()},
+                         str);
+    }
+
+    if (!cachePath.isEmpty()) {
+        // best effort: the next run rasterizes it again if this fails
+        static_cast<void>(image.save(cachePath, "PNG"));
+    }
+
+    return image;
 }
 
 } // namespace jome
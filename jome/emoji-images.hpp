@@ -8,29 +8,175 @@
 #ifndef _JOME_EMOJI_IMAGES_HPP
 #define _JOME_EMOJI_IMAGES_HPP
 
+#include <array>
+#include <vector>
 #include <memory>
-#include <unordered_map>
+#include <functional>
 #include <QPixmap>
+#include <QPainter>
+#include <QPoint>
+#include <QRect>
+#include <QFont>
+#include <QString>
+#include <boost/optional.hpp>
 
 #include "emoji-db.hpp"
+#include "dynamic-atlas.hpp"
+#include "emoji-svg-images.hpp"
 
 namespace jome {
 
+/*
+ * Images of all the emojis, from a single emoji PNG file.
+ *
+ * Only the PNG file of which the emoji size best matches the requested
+ * emoji size and device pixel ratio is loaded. The device pixel ratio
+ * of the resulting pixmap is set so that, when the emoji size times the
+ * device pixel ratio is one of `sizes`, drawing an emoji is a 1:1 copy.
+ *
+ * The skin tone variants aren't part of this PNG file: each one is
+ * loaded from its own PNG file into an atlas the first time it's drawn.
+ *
+ * With a font source, the images come from a color emoji font instead:
+ * each emoji is rasterized into the atlas the first time it's drawn,
+ * and possibly saved to a disk cache so that later runs only need to
+ * load it. The emoji PNG file is the fallback for the emojis which the
+ * font doesn't have.
+ *
+ * With an SVG source, the images are rasterized from SVG files, at the
+ * exact physical emoji size, by an EmojiSvgImages on worker threads.
+ * Until the image of an emoji is ready, it's drawn from the emoji PNG
+ * file.
+ *
+ * The emojis of custom emoji packs always go through the atlas. A shard
+ * of a pack is only loaded the first time one of its emojis is drawn,
+ * and only the few most recently used shards stay loaded.
+ */
 class EmojiImages
 {
 public:
-    explicit EmojiImages(const EmojiDb& db);
+    // available emoji sizes (pixels), smallest first
+    static constexpr std::array<unsigned int, 3> sizes {{32, 64, 128}};
+
+    // color emoji font to render the emojis with
+    struct FontSource
+    {
+        // font family (for example, `Noto Color Emoji`)
+        QString family;
+
+        // save the rasterized emojis to a disk cache
+        bool diskCache = true;
+    };
+
+    // directory of emoji SVG files to rasterize the emojis from
+    struct SvgSource
+    {
+        QString dir;
+    };
+
+    using ImagesReadyFunc = EmojiSvgImages::ImagesReadyFunc;
+
+public:
+    explicit EmojiImages(const EmojiDb& db, unsigned int emojiSize,
+                         qreal devicePixelRatio,
+                         const boost::optional<FontSource>& fontSource = boost::none,
+                         const boost::optional<SvgSource>& svgSource = boost::none);
+
+    /*
+     * Sets the function to call, from any thread, when images which
+     * weren't ready before are ready to be drawn.
+     */
+    void imagesReadyFunc(ImagesReadyFunc func);
 
-    const QPixmap& pixmapForEmoji(const Emoji& emoji) const
+    /*
+     * Draws `emoji`, from the emoji PNG file, with its top-left corner
+     * at `pos` (logical pixels).
+     */
+    void drawEmoji(QPainter& painter, const QPoint& pos,
+                   const Emoji& emoji) const
     {
-        return *_emojiPixmaps.at(&emoji);
+        painter.drawPixmap(pos, _pixmap, QRect {
+            _emojiPixmapPositions[emoji.index()],
+            QSize {static_cast<int>(_imageSize), static_cast<int>(_imageSize)}
+        });
     }
 
+    /*
+     * Draws `emoji` with the skin tone `skinTone` with its top-left
+     * corner at `pos` (logical pixels).
+     *
+     * Draws the emoji without a skin tone if `skinTone` is
+     * `Emoji::SkinTone::NONE`, if `emoji` doesn't support skin tones,
+     * or if its variant image is missing.
+     */
+    void drawEmoji(QPainter& painter, const QPoint& pos, const Emoji& emoji,
+                   Emoji::SkinTone skinTone);
+
+    /*
+     * Releases the images of the atlas: they're loaded or rasterized
+     * again when needed.
+     */
+    void trimCaches();
+
+    // size (pixels) of an emoji image within the loaded PNG file
+    unsigned int imageSize() const noexcept
+    {
+        return _imageSize;
+    }
+
+private:
+    void _loadPixmap(const EmojiDb& db, unsigned int emojiSize,
+                     qreal devicePixelRatio);
+    void _setFont(const FontSource& fontSource);
+    QImage _image(const Emoji& emoji, Emoji::SkinTone skinTone) const;
+    QImage _pixmapImage(const Emoji& emoji) const;
+    QImage _packImage(const Emoji& emoji) const;
+    const QImage& _packShardImage(const EmojiPack& pack,
+                                  unsigned int shardIndex) const;
+    QImage _skinToneImage(const Emoji& emoji, Emoji::SkinTone skinTone) const;
+    QImage _fontImage(const Emoji& emoji, Emoji::SkinTone skinTone) const;
+    bool _fontHasEmoji(const Emoji::Codepoints& codepoints) const;
+
 private:
-    void _createPixmaps(const EmojiDb& db);
+    // loaded shard of a custom emoji pack
+    struct _PackShard
+    {
+        const EmojiPack *pack;
+        unsigned int index;
+        QImage image;
+    };
 
 private:
-    std::unordered_map<const Emoji *, std::unique_ptr<QPixmap>> _emojiPixmaps;
+    const EmojiDb * const _emojiDb;
+    QPixmap _pixmap;
+    unsigned int _imageSize = sizes[0];
+
+    // position of each emoji within `_pixmap` (indexed by emoji index)
+    std::vector<QPoint> _emojiPixmapPositions;
+
+    // size (pixels) of the images of `_atlas`
+    unsigned int _atlasImageSize = sizes[0];
+
+    // color emoji font (pixel size: `_atlasImageSize`), if any
+    boost::optional<QFont> _font;
+
+    // directory of the disk cache of `_font` (none if empty)
+    QString _fontCacheDir;
+
+    /*
+     * Images which aren't drawn from `_pixmap` (variant: skin tone):
+     * skin tone variants and, with a font or SVG files, all the emojis.
+     */
+    std::unique_ptr<DynamicAtlas> _atlas;
+
+    // loaded pack shards, most recently used first
+    mutable std::vector<_PackShard> _packShards;
+
+    // total size (bytes) of the images of `_packShards`
+    mutable std::size_t _packShardsBytes = 0;
+
+    // SVG rasterizer, if any
+    std::unique_ptr<EmojiSvgImages> _svgImages;
 };
 
 } // namespace jome
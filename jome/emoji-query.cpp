@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+
+#include "emoji-query.hpp"
+
+namespace jome {
+
+void EmojiQuery::parse(const char16_t * const str, const std::size_t len)
+{
+    this->_encodeUtf8(str, len);
+    this->_tokenize();
+}
+
+void EmojiQuery::_encodeUtf8(const char16_t * const str,
+                             const std::size_t len)
+{
+    // `clear()` keeps the capacity of the buffer
+    _buf.clear();
+
+    for (std::size_t i = 0; i < len; ++i) {
+        char32_t codepoint = str[i];
+
+        if (codepoint >= 0xd800 && codepoint < 0xdc00 && i + 1 < len &&
+                str[i + 1] >= 0xdc00 && str[i + 1] < 0xe000) {
+            // surrogate pair
+            codepoint = 0x10000 + ((codepoint - 0xd800) << 10) +
+                        (str[i + 1] - 0xdc00);
+            ++i;
+        } else if (codepoint >= 0xd800 && codepoint < 0xe000) {
+            // lone surrogate
+            codepoint = 0xfffd;
+        }
+
+        if (codepoint < 0x80) {
+            _buf += static_cast<char>(codepoint);
+        } else if (codepoint < 0x800) {
+            _buf += static_cast<char>(0xc0 | (codepoint >> 6));
+            _buf += static_cast<char>(0x80 | (codepoint & 0x3f));
+        } else if (codepoint < 0x10000) {
+            _buf += static_cast<char>(0xe0 | (codepoint >> 12));
+            _buf += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+            _buf += static_cast<char>(0x80 | (codepoint & 0x3f));
+        } else {
+            _buf += static_cast<char>(0xf0 | (codepoint >> 18));
+            _buf += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+            _buf += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+            _buf += static_cast<char>(0x80 | (codepoint & 0x3f));
+        }
+    }
+}
+
+static bool isSpace(const char ch) noexcept
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' ||
+           ch == '\f' || ch == '\v';
+}
+
+static std::string_view trimmed(std::string_view str) noexcept
+{
+    while (!str.empty() && isSpace(str.front())) {
+        str.remove_prefix(1);
+    }
+
+    while (!str.empty() && isSpace(str.back())) {
+        str.remove_suffix(1);
+    }
+
+    return str;
+}
+
+void EmojiQuery::_tokenize()
+{
+    const std::string_view str {_buf};
+    std::string_view needlesStr = str;
+
+    _cat = {};
+    _needleCount = 0;
+    _hasExtraNeedles = false;
+
+    /*
+     * A query with exactly one `/` has a category part: with no or
+     * more than one `/`, the whole query is the needles part.
+     */
+    const auto slashPos = str.find('/');
+
+    if (slashPos != std::string_view::npos &&
+            str.find('/', slashPos + 1) == std::string_view::npos) {
+        _cat = trimmed(str.substr(0, slashPos));
+        needlesStr = str.substr(slashPos + 1);
+    }
+
+    // split needles part into individual, non-empty needles
+    while (!needlesStr.empty()) {
+        const auto spacePos = std::min(needlesStr.find(' '),
+                                       needlesStr.size());
+
+        if (spacePos > 0) {
+            if (_needleCount == _needles.size()) {
+                _hasExtraNeedles = true;
+                return;
+            }
+
+            _needles[_needleCount] = needlesStr.substr(0, spacePos);
+            ++_needleCount;
+        }
+
+        needlesStr.remove_prefix(std::min(spacePos + 1, needlesStr.size()));
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_EMOJI_QUERY_HPP
+#define _JOME_EMOJI_QUERY_HPP
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace jome {
+
+/*
+ * Parsed find query.
+ *
+ * The format of a query is one of `TERMS`, `CAT/`, or `CAT/TERMS`,
+ * where `TERMS` is a space-separated list of needles.
+ *
+ * parse() encodes the query string as UTF-8 into a single buffer, and
+ * the category and needles are views into this buffer. Parse each new
+ * query string with the same instance to reuse this buffer.
+ *
+ * A query has at most `maxNeedleCount` needles: a query with more has
+ * extra needles (see hasExtraNeedles()), which no emoji matches, instead
+ * of a query which matches more than what the user typed.
+ */
+class EmojiQuery
+{
+public:
+    static constexpr std::size_t maxNeedleCount = 16;
+
+public:
+    void parse(const char16_t *str, std::size_t len);
+
+    std::string_view cat() const noexcept
+    {
+        return _cat;
+    }
+
+    const std::string_view *needlesBegin() const noexcept
+    {
+        return _needles.data();
+    }
+
+    const std::string_view *needlesEnd() const noexcept
+    {
+        return _needles.data() + _needleCount;
+    }
+
+    std::size_t needleCount() const noexcept
+    {
+        return _needleCount;
+    }
+
+    // whether or not the query has more than `maxNeedleCount` needles
+    bool hasExtraNeedles() const noexcept
+    {
+        return _hasExtraNeedles;
+    }
+
+private:
+    void _encodeUtf8(const char16_t *str, std::size_t len);
+    void _tokenize();
+
+private:
+    std::string _buf;
+    std::string_view _cat;
+    std::array<std::string_view, maxNeedleCount> _needles;
+    std::size_t _needleCount = 0;
+    bool _hasExtraNeedles = false;
+};
+
+} // namespace jome
+
+#endif // _JOME_EMOJI_QUERY_HPP
@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QCryptographicHash>
+#include <QSaveFile>
+
+#include "emoji-svg-images.hpp"
+#include "thread-pool.hpp"
+
+namespace jome {
+
+static constexpr char cacheMagic[] = {'j', 'o', 'm', 'e', 's', 'v', 'g', 'c'};
+
+// notify every time that many emojis are ready (and when all are)
+static constexpr std::size_t notifyBatchSize = 64;
+
+EmojiSvgImages::EmojiSvgImages(const EmojiDb& db, const QString& svgDir,
+                               const unsigned int imageSize,
+                               const QString& cachePath) :
+    _emojiDb {&db},
+    _svgDir {svgDir},
+    _imageSize {imageSize},
+    _cachePath {cachePath},
+    _cacheFile {cachePath},
+    _images(db.emojis().size()),
+    _ready {new std::atomic<bool>[db.emojis().size()]}
+{
+    for (std::size_t i = 0; i < db.emojis().size(); ++i) {
+        _ready[i] = false;
+    }
+
+    this->_mapCache();
+    _thread = std::thread {[this]() {
+        this->_rasterizeAll();
+    }};
+}
+
+EmojiSvgImages::~EmojiSvgImages()
+{
+    _stop = true;
+    _thread.join();
+
+    // images rasterized on demand since the worker threads finished
+    this->_saveCache();
+}
+
+void EmojiSvgImages::imagesReadyFunc(ImagesReadyFunc func)
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    _imagesReadyFunc = std::move(func);
+}
+
+std::size_t EmojiSvgImages::_imageBytes() const noexcept
+{
+    return static_cast<std::size_t>(_imageSize) * _imageSize * 4;
+}
+
+void EmojiSvgImages::_mapCache()
+{
+    if (!_cacheFile.open(QIODevice::ReadOnly)) {
+        // no cache yet
+        return;
+    }
+
+    const auto fileSize = static_cast<std::uint64_t>(_cacheFile.size());
+
+    if (fileSize < sizeof(_CacheHeader)) {
+        return;
+    }
+
+    const auto data = _cacheFile.map(0, _cacheFile.size());
+
+    if (!data) {
+        return;
+    }
+
+    _CacheHeader header;
+
+    std::memcpy(&header, data, sizeof header);
+
+    if (std::memcmp(header.magic, cacheMagic, sizeof cacheMagic) != 0 ||
+            header.version != _cacheVersion ||
+            header.imageSize != _imageSize ||
+            header.entryCount > (fileSize - sizeof header) / sizeof(_CacheEntry)) {
+        // other version or size: rewritten when saving
+        return;
+    }
+
+    for (std::uint64_t i = 0; i < header.entryCount; ++i) {
+        _CacheEntry entry;
+
+        std::memcpy(&entry, data + sizeof header + i * sizeof entry,
+                    sizeof entry);
+
+        if (entry.offset > fileSize || fileSize - entry.offset < this->_imageBytes()) {
+            // truncated
+            continue;
+        }
+
+        _cachedPixels.emplace(std::string {
+            reinterpret_cast<const char *>(entry.hash), sizeof entry.hash
+        }, data + entry.offset);
+    }
+}
+
+void EmojiSvgImages::_saveCache()
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    if (!_cacheDirty) {
+        return;
+    }
+
+    /*
+     * Keep the cached entries of which an SVG file of this run has the
+     * hash. Until all the SVG files are hashed, keep them all.
+     */
+    std::vector<std::pair<const std::string *, const std::uint8_t *>> keptPixels;
+
+    for (const auto& hashPixelsPair : _cachedPixels) {
+        if (!_liveHashesComplete ||
+                _liveHashes.find(hashPixelsPair.first) != std::end(_liveHashes)) {
+            keptPixels.emplace_back(&hashPixelsPair.first, hashPixelsPair.second);
+        }
+    }
+
+    /*
+     * QSaveFile writes a temporary file and renames it: the current
+     * mapping of the previous file remains valid.
+     */
+    QSaveFile file {_cachePath};
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    _CacheHeader header;
+
+    std::memcpy(header.magic, cacheMagic, sizeof cacheMagic);
+    header.version = _cacheVersion;
+    header.imageSize = _imageSize;
+    header.entryCount = keptPixels.size() + _newImages.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof header);
+
+    auto offset = sizeof header + header.entryCount * sizeof(_CacheEntry);
+    const auto writeEntry = [this, &file, &offset](const std::string& hash) {
+        _CacheEntry entry {};
+
+        std::memcpy(entry.hash, hash.data(), sizeof entry.hash);
+        entry.offset = offset;
+        file.write(reinterpret_cast<const char *>(&entry), sizeof entry);
+        offset += this->_imageBytes();
+    };
+
+    for (const auto& hashPixelsPair : keptPixels) {
+        writeEntry(*hashPixelsPair.first);
+    }
+
+    for (const auto& hashImagePair : _newImages) {
+        writeEntry(hashImagePair.first);
+    }
+
+    for (const auto& hashPixelsPair : keptPixels) {
+        file.write(reinterpret_cast<const char *>(hashPixelsPair.second),
+                   this->_imageBytes());
+    }
+
+    for (const auto& hashImagePair : _newImages) {
+        const auto& image = hashImagePair.second;
+
+        for (auto y = 0; y < image.height(); ++y) {
+            file.write(reinterpret_cast<const char *>(image.constScanLine(y)),
+                       _imageSize * 4);
+        }
+    }
+
+    if (file.commit()) {
+        /*
+         * Keep `_newImages`: `_cachedPixels` still maps the file of the
+         * start of this run, so the next save must write them again.
+         */
+        _cacheDirty = false;
+    }
+}
+
+QByteArray EmojiSvgImages::_readSvg(const Emoji& emoji,
+                                    const Emoji::SkinTone skinTone) const
+{
+    auto stem = QString::fromStdString(emoji.fileStem(skinTone));
+
+    // like `gen-data/create.py`: try without U+FE0F too
+    for (auto i = 0; i < 2; ++i) {
+        QFile file {_svgDir + '/' + stem + ".svg"};
+
+        if (file.open(QIODevice::ReadOnly)) {
+            return file.readAll();
+        }
+
+        stem.remove("-fe0f");
+    }
+
+    return {};
+}
+
+QImage EmojiSvgImages::_rasterize(const QByteArray& svg) const
+{
+    QSvgRenderer renderer {svg};
+
+    if (!renderer.isValid()) {
+        return {};
+    }
+
+    const auto size = static_cast<int>(_imageSize);
+    QImage image {size, size, QImage::Format_ARGB32_Premultiplied};
+
+    image.fill(Qt::transparent);
+
+    QPainter painter {&image};
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    renderer.render(&painter);
+    return image;
+}
+
+std::string EmojiSvgImages::_svgHash(const QByteArray& svg)
+{
+    const auto hashBytes = QCryptographicHash::hash(svg, QCryptographicHash::Sha1);
+    std::string hash {hashBytes.constData(),
+                      static_cast<std::size_t>(hashBytes.size())};
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    _liveHashes.insert(hash);
+    return hash;
+}
+
+QImage EmojiSvgImages::_cachedImage(const std::string& hash)
+{
+    const auto it = _cachedPixels.find(hash);
+
+    if (it != std::end(_cachedPixels)) {
+        // shares the mapped pixels
+        const auto size = static_cast<int>(_imageSize);
+
+        return QImage {
+            it->second, size, size, size * 4,
+            QImage::Format_ARGB32_Premultiplied
+        };
+    }
+
+    std::lock_guard<std::mutex> lock {_mutex};
+    const auto newIt = _newImages.find(hash);
+
+    if (newIt != std::end(_newImages)) {
+        return newIt->second;
+    }
+
+    return {};
+}
+
+QImage EmojiSvgImages::image(const Emoji& emoji,
+                             const Emoji::SkinTone skinTone)
+{
+    const auto svg = this->_readSvg(emoji, skinTone);
+
+    if (svg.isEmpty()) {
+        return {};
+    }
+
+    const auto hash = this->_svgHash(svg);
+    auto image = this->_cachedImage(hash);
+
+    if (!image.isNull()) {
+        return image;
+    }
+
+    image = this->_rasterize(svg);
+
+    if (!image.isNull()) {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _newImages.emplace(hash, image);
+        _cacheDirty = true;
+    }
+
+    return image;
+}
+
+void EmojiSvgImages::_notifyImagesReady()
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    if (_imagesReadyFunc) {
+        _imagesReadyFunc();
+    }
+}
+
+void EmojiSvgImages::_hashVariantSvgs(const std::vector<const Emoji *>& emojis)
+{
+    static constexpr Emoji::SkinTone skinTones[] = {
+        Emoji::SkinTone::LIGHT,
+        Emoji::SkinTone::MEDIUM_LIGHT,
+        Emoji::SkinTone::MEDIUM,
+        Emoji::SkinTone::MEDIUM_DARK,
+        Emoji::SkinTone::DARK,
+    };
+
+    // rasterized on demand: only their hashes are needed here
+    auto hash = [this, &emojis](const std::size_t index) {
+        if (_stop) {
+            return;
+        }
+
+        const auto& emoji = *emojis[index];
+
+        if (!emoji.hasSkinToneSupport()) {
+            return;
+        }
+
+        for (const auto skinTone : skinTones) {
+            const auto svg = this->_readSvg(emoji, skinTone);
+
+            if (!svg.isEmpty()) {
+                this->_svgHash(svg);
+            }
+        }
+    };
+
+    const auto threadCount = std::max(std::thread::hardware_concurrency(), 2U);
+
+    ThreadPool {threadCount - 1}.run(emojis.size(), hash);
+
+    if (_stop) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    _liveHashesComplete = true;
+
+    for (const auto& hashPixelsPair : _cachedPixels) {
+        if (_liveHashes.find(hashPixelsPair.first) == std::end(_liveHashes)) {
+            // stale entry: rewrite the file without it
+            _cacheDirty = true;
+            break;
+        }
+    }
+}
+
+void EmojiSvgImages::_rasterizeAll()
+{
+    // display order so that the first visible emojis are ready first
+    std::vector<const Emoji *> emojis;
+    std::vector<bool> added(_emojiDb->emojis().size());
+
+    for (const auto& cat : _emojiDb->cats()) {
+        for (const auto emoji : cat->emojis()) {
+            // the images of pack emojis come from their shards
+            if (!emoji->pack() && !added[emoji->index()]) {
+                added[emoji->index()] = true;
+                emojis.push_back(emoji);
+            }
+        }
+    }
+
+    std::atomic<std::size_t> readyCount {0};
+    auto rasterize = [this, &emojis, &readyCount](const std::size_t index) {
+        if (_stop) {
+            return;
+        }
+
+        const auto& emoji = *emojis[index];
+
+        _images[emoji.index()] = this->image(emoji, Emoji::SkinTone::NONE);
+        _ready[emoji.index()].store(true, std::memory_order_release);
+
+        if (++readyCount % notifyBatchSize == 0) {
+            this->_notifyImagesReady();
+        }
+    };
+
+    const auto threadCount = std::max(std::thread::hardware_concurrency(), 2U);
+
+    // this thread is one of the workers
+    ThreadPool {threadCount - 1}.run(emojis.size(), rasterize);
+
+    if (_stop) {
+        return;
+    }
+
+    this->_notifyImagesReady();
+    this->_hashVariantSvgs(emojis);
+    this->_saveCache();
+}
+
+} // namespace jome
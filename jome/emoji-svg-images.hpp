@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_EMOJI_SVG_IMAGES_HPP
+#define _JOME_EMOJI_SVG_IMAGES_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+#include <QFile>
+
+#include "emoji-db.hpp"
+
+namespace jome {
+
+/*
+ * Images of the emojis rasterized at any size from a directory of SVG
+ * files named like the emoji PNG files (dash-separated hexadecimal
+ * codepoints).
+ *
+ * The constructor starts rasterizing the emojis without a skin tone,
+ * in display order, on worker threads; isReady() indicates whether or
+ * not the image of a given emoji is available.
+ *
+ * The rasters persist in a single cache file, keyed by the SHA-1 hash
+ * of the SVG file, for a given image size. An instance maps this file
+ * into memory: a later run only needs to read and hash the SVG files,
+ * not to rasterize them again.
+ *
+ * Once the worker threads are done, they also hash the SVG files of
+ * the skin tone variants: saving the cache then drops the entries of
+ * which no SVG file has the hash anymore.
+ *
+ * Cache file layout (native byte order):
+ *
+ *     Header:
+ *         Magic (8 bytes): `jomesvgc`
+ *         Version (32-bit): 1
+ *         Image size (32-bit)
+ *         Entry count (64-bit)
+ *
+ *     Entries (entry count times):
+ *         SHA-1 hash of the SVG file (20 bytes)
+ *         Padding (4 bytes)
+ *         Offset of the image from the beginning of the file (64-bit)
+ *
+ *     Images: premultiplied ARGB32 pixels, without any row padding.
+ */
+class EmojiSvgImages
+{
+public:
+    // called from any thread when new images are ready
+    using ImagesReadyFunc = std::function<void ()>;
+
+public:
+    explicit EmojiSvgImages(const EmojiDb& db, const QString& svgDir,
+                            unsigned int imageSize, const QString& cachePath);
+    ~EmojiSvgImages();
+
+    // sets the function to call when new images are ready
+    void imagesReadyFunc(ImagesReadyFunc func);
+
+    // true if the worker threads are done with `emoji`
+    bool isReady(const Emoji& emoji) const noexcept
+    {
+        return _ready[emoji.index()].load(std::memory_order_acquire);
+    }
+
+    /*
+     * Image of `emoji` without a skin tone, or null image if its SVG
+     * file is missing or invalid.
+     *
+     * isReady() must be true for `emoji`.
+     */
+    const QImage& readyImage(const Emoji& emoji) const noexcept
+    {
+        return _images[emoji.index()];
+    }
+
+    /*
+     * Image of `emoji` with the skin tone `skinTone`, rasterized on the
+     * calling thread if needed, or null image if its SVG file is
+     * missing or invalid.
+     */
+    QImage image(const Emoji& emoji, Emoji::SkinTone skinTone);
+
+    unsigned int imageSize() const noexcept
+    {
+        return _imageSize;
+    }
+
+private:
+    static constexpr std::uint32_t _cacheVersion = 1;
+
+    struct _CacheHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t imageSize;
+        std::uint64_t entryCount;
+    };
+
+    struct _CacheEntry
+    {
+        std::uint8_t hash[20];
+        std::uint32_t padding;
+        std::uint64_t offset;
+    };
+
+private:
+    void _mapCache();
+    void _saveCache();
+    void _rasterizeAll();
+    void _notifyImagesReady();
+    QByteArray _readSvg(const Emoji& emoji, Emoji::SkinTone skinTone) const;
+    QImage _rasterize(const QByteArray& svg) const;
+    QImage _cachedImage(const std::string& hash);
+    std::string _svgHash(const QByteArray& svg);
+    void _hashVariantSvgs(const std::vector<const Emoji *>& emojis);
+    std::size_t _imageBytes() const noexcept;
+
+private:
+    const EmojiDb * const _emojiDb;
+    const QString _svgDir;
+    const unsigned int _imageSize;
+    const QString _cachePath;
+
+    // mapped cache file, and its images by SVG hash (read-only)
+    QFile _cacheFile;
+    std::unordered_map<std::string, const std::uint8_t *> _cachedPixels;
+
+    // protects what follows until `_images`
+    std::mutex _mutex;
+
+    /*
+     * Images which aren't in the mapped cache file, by SVG hash: saving
+     * the cache writes all of them, including the ones which a previous
+     * save already wrote.
+     */
+    std::unordered_map<std::string, QImage> _newImages;
+
+    // whether or not the cache file lacks images or has stale entries
+    bool _cacheDirty = false;
+
+    // hashes of the SVG files read during this run
+    std::unordered_set<std::string> _liveHashes;
+
+    // whether or not `_liveHashes` has the hashes of all the SVG files
+    bool _liveHashesComplete = false;
+
+    ImagesReadyFunc _imagesReadyFunc;
+
+    // images without a skin tone (indexed by emoji index)
+    std::vector<QImage> _images;
+
+    // whether or not each entry of `_images` is set
+    std::unique_ptr<std::atomic<bool>[]> _ready;
+
+    std::atomic<bool> _stop {false};
+    std::thread _thread;
+};
+
+} // namespace jome
+
+#endif // _JOME_EMOJI_SVG_IMAGES_HPP
@@ -11,13 +11,21 @@
 #include <QProcess>
 #include <QTimer>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <cstdio>
 #include <cstdlib>
+#include <limits>
 
 #include "emoji-db.hpp"
 #include "emoji-images.hpp"
+#include "unicode-db.hpp"
+#include "latency-probe.hpp"
 #include "q-jome-window.hpp"
+#include "q-unicode-window.hpp"
 #include "q-jome-server.hpp"
+#include "q-jome-style.hpp"
+#include "tinyutf8.hpp"
 
 enum class Format {
     UTF8,
@@ -31,6 +39,12 @@ struct Params
     std::string serverName;
     std::string cmd;
     std::string cpPrefix;
+    bool measureLatency;
+    bool unicode;
+    boost::optional<jome::EmojiImages::FontSource> emojiFontSource;
+    boost::optional<jome::EmojiImages::SvgSource> emojiSvgSource;
+    std::vector<std::string> emojiPackDirs;
+    int idleTrimDelay;
 };
 
 static Params parseArgs(QApplication& app, int argc, char **argv)
@@ -46,17 +60,37 @@ static Params parseArgs(QApplication& app, int argc, char **argv)
     QCommandLineOption cmdOpt {"c", "External command", "CMD"};
     QCommandLineOption cpPrefixOpt {"p", "Codepoint prefix", "CPPREFIX"};
     QCommandLineOption noNlOpt {"n", "Do not output newline"};
+    QCommandLineOption latencyOpt {"L", "Measure keystroke-to-paint latency"};
+    QCommandLineOption fontOpt {"F", "Color emoji font", "FONT"};
+    QCommandLineOption noFontCacheOpt {"R", "Do not cache the font emojis on disk"};
+    QCommandLineOption svgDirOpt {"V", "Emoji SVG directory", "DIR"};
+    QCommandLineOption packDirOpt {"P", "Custom emoji pack directory", "DIR"};
+    QCommandLineOption unicodeOpt {
+        QStringList {"u", "unicode"}, "Pick any Unicode character"
+    };
+    QCommandLineOption idleTrimDelayOpt {
+        "I", "Trim caches after SECONDS hidden (server mode)", "SECONDS", "600"
+    };
 
     parser.addOption(formatOpt);
     parser.addOption(serverNameOpt);
     parser.addOption(cmdOpt);
     parser.addOption(cpPrefixOpt);
     parser.addOption(noNlOpt);
+    parser.addOption(latencyOpt);
+    parser.addOption(fontOpt);
+    parser.addOption(noFontCacheOpt);
+    parser.addOption(svgDirOpt);
+    parser.addOption(packDirOpt);
+    parser.addOption(unicodeOpt);
+    parser.addOption(idleTrimDelayOpt);
     parser.process(app);
 
     Params params;
 
     params.noNewline = parser.isSet(noNlOpt);
+    params.measureLatency = parser.isSet(latencyOpt);
+    params.unicode = parser.isSet(unicodeOpt);
 
     const auto fmt = parser.value(formatOpt);
 
@@ -70,6 +104,19 @@ static Params parseArgs(QApplication& app, int argc, char **argv)
         std::exit(1);
     }
 
+    bool idleTrimDelayOk;
+
+    params.idleTrimDelay = parser.value(idleTrimDelayOpt).toInt(&idleTrimDelayOk);
+
+    // the idle trim timer has an interval in milliseconds within an `int`
+    if (!idleTrimDelayOk || params.idleTrimDelay < 0 ||
+            params.idleTrimDelay > std::numeric_limits<int>::max() / 1000) {
+        std::cerr << "Command-line error: invalid idle trim delay `" <<
+                     parser.value(idleTrimDelayOpt).toUtf8().constData() <<
+                     "`." << std::endl;
+        std::exit(1);
+    }
+
     if (parser.isSet(serverNameOpt)) {
         params.serverName = parser.value(serverNameOpt).toUtf8().constData();
     }
@@ -82,6 +129,29 @@ static Params parseArgs(QApplication& app, int argc, char **argv)
         params.cpPrefix = parser.value(cpPrefixOpt).toUtf8().constData();
     }
 
+    if (parser.isSet(fontOpt)) {
+        params.emojiFontSource = jome::EmojiImages::FontSource {};
+        params.emojiFontSource->family = parser.value(fontOpt);
+        params.emojiFontSource->diskCache = !parser.isSet(noFontCacheOpt);
+    }
+
+    if (parser.isSet(svgDirOpt)) {
+        if (params.emojiFontSource) {
+            std::cerr << "Command-line error: cannot specify both `-F` and `-V`." <<
+                         std::endl;
+            std::exit(1);
+        }
+
+        params.emojiSvgSource = jome::EmojiImages::SvgSource {
+            parser.value(svgDirOpt)
+        };
+    }
+
+    // `-P` can be repeated
+    for (const auto& packDir : parser.values(packDirOpt)) {
+        params.emojiPackDirs.push_back(packDir.toUtf8().constData());
+    }
+
     return params;
 }
 
@@ -112,12 +182,18 @@ static std::string formatEmoji(const jome::Emoji& emoji,
             str = emoji.str();
         }
 
-        output = emoji.str();
+        output = std::move(str);
         break;
     }
 
     case Format::CODEPOINTS_HEX:
     {
+        if (emoji.pack()) {
+            // a pack emoji has no Unicode codepoints: `:NAME:` anyway
+            output = emoji.str();
+            break;
+        }
+
         jome::Emoji::Codepoints codepoints;
 
         if (emoji.hasSkinToneSupport()) {
@@ -147,79 +223,92 @@ static std::string formatEmoji(const jome::Emoji& emoji,
     return output;
 }
 
-int main(int argc, char **argv)
+static std::string formatCodepoint(const char32_t codepoint, const Format fmt,
+                                   const std::string& cpPrefix,
+                                   const bool noNl)
 {
-    QApplication app {argc, argv};
-    std::unique_ptr<jome::QJomeServer> server;
+    std::string output;
 
-    app.setApplicationDisplayName("jome");
-    app.setOrganizationName("jome");
-    app.setApplicationName("jome");
-    app.setApplicationVersion(JOME_VERSION);
+    switch (fmt) {
+    case Format::UTF8:
+        output = utf8_string {codepoint}.c_str();
+        break;
 
-    const auto params = parseArgs(app, argc, argv);
-    jome::EmojiDb db {JOME_DATA_DIR};
-    jome::QJomeWindow win {db};
+    case Format::CODEPOINTS_HEX:
+    {
+        std::array<char, 32> buf;
 
-    QObject::connect(&win, &jome::QJomeWindow::canceled,
-                     [&params, &app, &server]() {
-        if (server) {
-            // reply to the client at least
-            server->sendToClient("");
-        }
+        std::sprintf(buf.data(), "%s%x", cpPrefix.c_str(),
+                     static_cast<unsigned int>(codepoint));
+        output = buf.data();
+        break;
+    }
+    }
 
-        if (!server) {
-            // TODO: make sure the message is sent before quitting
-            QTimer::singleShot(0, [&app]() {
-                app.exit(1);
-            });
-        }
-    });
-    QObject::connect(&win, &jome::QJomeWindow::emojiChosen,
-                     [&](const auto& emoji, const auto skinTone) {
-        const auto emojiStr = formatEmoji(emoji, skinTone, params.fmt,
-                                          params.cpPrefix,
-                                          params.noNewline || !params.cmd.empty());
+    if (!noNl) {
+        output += '\n';
+    }
 
-        if (server) {
-            // send response to client
-            server->sendToClient(emojiStr);
-        }
+    return output;
+}
+
+/*
+ * Outputs the chosen `str` (reply to the client, standard output,
+ * external command), then quits without a server.
+ */
+static void outputChoice(QApplication& app, const Params& params,
+                         jome::QJomeServer * const server,
+                         const std::string& str)
+{
+    if (server) {
+        // send response to client
+        server->sendToClient(str);
+    }
 
-        // print result
-        std::cout << emojiStr;
-        std::cout.flush();
+    // print result
+    std::cout << str;
+    std::cout.flush();
 
-        if (!params.cmd.empty()) {
-            // execute command in 20 ms
-            QTimer::singleShot(20, &app, [&params, &server, &app, emojiStr]() {
-                execCommand(params.cmd, emojiStr);
+    if (!params.cmd.empty()) {
+        // execute command in 20 ms
+        QTimer::singleShot(20, &app, [&params, server, &app, str]() {
+            execCommand(params.cmd, str);
 
-                if (!server) {
-                    // no server: quit after executing the command
-                    QTimer::singleShot(0, &app, &QApplication::quit);
-                }
-            });
-        } else {
             if (!server) {
-                // no server: quit now
+                // no server: quit after executing the command
                 QTimer::singleShot(0, &app, &QApplication::quit);
             }
+        });
+    } else {
+        if (!server) {
+            // no server: quit now
+            QTimer::singleShot(0, &app, &QApplication::quit);
         }
+    }
+}
 
-        // always hide when accepting
-        win.hide();
-
-        // add emoji as recent emoji
-        db.addRecentEmoji(emoji);
-
+/*
+ * Starts the server (if needed) to show `win` on request, or shows
+ * `win`, and runs the event loop.
+ *
+ * `WindowT` is QJomeWindow or QUnicodeWindow.
+ */
+template <typename WindowT>
+static int run(QApplication& app, const Params& params, WindowT& win,
+                std::unique_ptr<jome::QJomeServer>& server,
+                jome::LatencyProbe * const latencyProbe)
+{
+    QObject::connect(&win, &WindowT::canceled, [&app, &server]() {
         if (server) {
-            /*
-             * Not calling directly because we're potentially within an
-             * event handler which is currently using an emoji graphics
-             * item, so we cannot delete it.
-             */
-            QTimer::singleShot(0, &win, &jome::QJomeWindow::emojiDbChanged);
+            // reply to the client at least
+            server->sendToClient("");
+        }
+
+        if (!server) {
+            // TODO: make sure the message is sent before quitting
+            QTimer::singleShot(0, [&app]() {
+                app.exit(1);
+            });
         }
     });
 
@@ -227,22 +316,119 @@ int main(int argc, char **argv)
         server = std::make_unique<jome::QJomeServer>(nullptr,
                                                      params.serverName);
         QObject::connect(server.get(), &jome::QJomeServer::clientRequested,
-                         [&app, &server, &win](const jome::QJomeServer::Command cmd) {
-            if (cmd == jome::QJomeServer::Command::QUIT) {
+                         [&server, &win, latencyProbe](const jome::QJomeServer::Command cmd) {
+            switch (cmd) {
+            case jome::QJomeServer::Command::QUIT:
                 // reply to client, then quit
                 server->sendToClient("");
 
                 // TODO: make sure the message is sent before quitting
                 QTimer::singleShot(10, &QApplication::quit);
-            } else {
+                break;
+
+            case jome::QJomeServer::Command::STATS:
+                if (latencyProbe) {
+                    server->sendToClient(latencyProbe->report());
+                } else {
+                    server->sendToClient("Latency probe is disabled (see the `-L` option).\n");
+                }
+
+                break;
+
+            case jome::QJomeServer::Command::PICK:
                 win.show();
+                break;
             }
         });
+
+        win.idleTrimDelay(params.idleTrimDelay);
+
+        /*
+         * Prepare the window as soon as the event loop runs so that
+         * the first request only needs to show it.
+         */
+        QTimer::singleShot(0, &win, &WindowT::prepare);
     }
 
     if (!server) {
         win.show();
     }
 
-    return app.exec();
+    const auto exitCode = app.exec();
+
+    if (latencyProbe) {
+        std::cerr << latencyProbe->report();
+    }
+
+    return exitCode;
+}
+
+int main(int argc, char **argv)
+{
+    QApplication app {argc, argv};
+    std::unique_ptr<jome::QJomeServer> server;
+
+    app.setApplicationDisplayName("jome");
+    app.setOrganizationName("jome");
+    app.setApplicationName("jome");
+    app.setApplicationVersion(JOME_VERSION);
+    app.setStyle(new jome::QJomeStyle);
+
+    const auto params = parseArgs(app, argc, argv);
+    std::unique_ptr<jome::LatencyProbe> latencyProbe;
+
+    if (params.measureLatency) {
+        latencyProbe = std::make_unique<jome::LatencyProbe>();
+    }
+
+    if (params.unicode) {
+        // no emoji database nor emoji images in this mode
+        jome::UnicodeDb db {JOME_DATA_DIR};
+        jome::QUnicodeWindow win {db, latencyProbe.get()};
+
+        QObject::connect(&win, &jome::QUnicodeWindow::charChosen,
+                         [&](const char32_t codepoint) {
+            outputChoice(app, params, server.get(),
+                         formatCodepoint(codepoint, params.fmt,
+                                         params.cpPrefix,
+                                         params.noNewline || !params.cmd.empty()));
+
+            // always hide when accepting
+            win.hide();
+        });
+
+        return run(app, params, win, server, latencyProbe.get());
+    }
+
+    jome::EmojiDb db {JOME_DATA_DIR, params.emojiPackDirs};
+    jome::QJomeWindow win {
+        db, params.emojiFontSource, params.emojiSvgSource, latencyProbe.get()
+    };
+
+    db.recentEmojisChangedFunc([&win](const jome::EmojiCat& cat) {
+        /*
+         * Not calling directly because we're potentially within an
+         * event handler of the emojis widget which is currently using
+         * its emojis, so we cannot update it.
+         */
+        QTimer::singleShot(0, &win, [&win, &cat]() {
+            win.emojiCatChanged(cat);
+        });
+    });
+
+    QObject::connect(&win, &jome::QJomeWindow::emojiChosen,
+                     [&](const auto& emoji, const auto skinTone) {
+        outputChoice(app, params, server.get(),
+                     formatEmoji(emoji, skinTone, params.fmt,
+                                 params.cpPrefix,
+                                 params.noNewline || !params.cmd.empty()));
+
+        // always hide when accepting
+        win.hide();
+
+        // add emoji as recent emoji
+        db.addRecentEmoji(emoji);
+    });
+
+    return run(app, params, win, server, latencyProbe.get());
 }
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cassert>
+#include <cstdio>
+
+#include "latency-probe.hpp"
+
+namespace jome {
+
+void LatencyProbe::keyPressed()
+{
+    // only a measurement once it changes the find text
+    _keyPressTime = _Clock::now();
+    _keyPressPending = true;
+}
+
+void LatencyProbe::cancel()
+{
+    _keyPressPending = false;
+    _measuring = false;
+}
+
+void LatencyProbe::reached(const Stage stage)
+{
+    if (stage == Stage::TEXT_CHANGED) {
+        // a text change without a key press (paste) isn't measured
+        _measuring = _keyPressPending;
+        _start = _keyPressTime;
+        _keyPressPending = false;
+    }
+
+    if (!_measuring) {
+        return;
+    }
+
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(_Clock::now() -
+                                                                               _start);
+    auto& stats = _stageStats[static_cast<std::size_t>(stage)];
+
+    ++stats.buckets[_bucketIndex(latency)];
+    ++stats.count;
+    stats.sum += latency;
+    stats.max = std::max(stats.max, latency);
+
+    if (stage == Stage::PAINT) {
+        // complete
+        _measuring = false;
+        this->_updateLastText(latency);
+    }
+}
+
+std::size_t LatencyProbe::_bucketIndex(const std::chrono::microseconds latency)
+{
+    auto units = static_cast<unsigned long long>(latency / bucketUnit);
+    std::size_t index = 0;
+
+    while (units > 0 && index < bucketCount - 1) {
+        units >>= 1;
+        ++index;
+    }
+
+    return index;
+}
+
+const char *LatencyProbe::_stageName(const Stage stage)
+{
+    switch (stage) {
+    case Stage::TEXT_CHANGED:
+        return "Text changed";
+
+    case Stage::FIND:
+        return "Find";
+
+    case Stage::GRID_UPDATE:
+        return "Grid update";
+
+    case Stage::PAINT:
+        return "Paint";
+    }
+
+    assert(false);
+    return "";
+}
+
+void LatencyProbe::_updateLastText(const std::chrono::microseconds latency)
+{
+    const auto& paintStats = _stageStats[static_cast<std::size_t>(Stage::PAINT)];
+    std::array<char, 128> buf;
+
+    std::snprintf(buf.data(), buf.size(),
+                  "Key to paint: %.2f ms (max %.2f ms, %llu samples)",
+                  latency.count() / 1000., paintStats.max.count() / 1000.,
+                  paintStats.count);
+    _lastText = buf.data();
+}
+
+std::string LatencyProbe::report() const
+{
+    std::string report;
+    std::array<char, 128> buf;
+
+    report += "Latencies since key press:\n\n";
+
+    for (auto stageI = 0U; stageI < stageCount; ++stageI) {
+        const auto& stats = _stageStats[stageI];
+
+        std::snprintf(buf.data(), buf.size(),
+                      "  %-14s %8llu samples, mean %8.2f ms, max %8.2f ms\n",
+                      _stageName(static_cast<Stage>(stageI)), stats.count,
+                      stats.count == 0 ? 0. :
+                      stats.sum.count() / 1000. / stats.count,
+                      stats.max.count() / 1000.);
+        report += buf.data();
+    }
+
+    const auto& paintStats = _stageStats[static_cast<std::size_t>(Stage::PAINT)];
+    unsigned long long overBudgetCount = 0;
+
+    report += "\nKey to paint histogram:\n\n";
+
+    for (auto bucketI = 0U; bucketI < bucketCount; ++bucketI) {
+        const auto count = paintStats.buckets[bucketI];
+        const auto begin = bucketI == 0 ? 0LL :
+                           (1LL << (bucketI - 1)) * bucketUnit.count();
+        const auto end = (1LL << bucketI) * bucketUnit.count();
+
+        if (bucketI == bucketCount - 1) {
+            std::snprintf(buf.data(), buf.size(), "  [%8.3f, %8s) ms: %8llu\n",
+                          begin / 1000., "inf", count);
+        } else {
+            std::snprintf(buf.data(), buf.size(), "  [%8.3f, %8.3f) ms: %8llu\n",
+                          begin / 1000., end / 1000., count);
+        }
+
+        report += buf.data();
+
+        if (end > frameBudget.count()) {
+            overBudgetCount += count;
+        }
+    }
+
+    std::snprintf(buf.data(), buf.size(),
+                  "\nPossibly over a frame (%.2f ms): %llu of %llu\n",
+                  frameBudget.count() / 1000., overBudgetCount,
+                  paintStats.count);
+    report += buf.data();
+    return report;
+}
+
+} // namespace jome
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_LATENCY_PROBE_HPP
+#define _JOME_LATENCY_PROBE_HPP
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <cstddef>
+
+namespace jome {
+
+/*
+ * Keystroke-to-paint latency probe.
+ *
+ * A measurement starts with a key press (keyPressed()) which changes
+ * the find text (first stage), then records the time at which each
+ * following stage is reached (reached()) until the emojis are painted,
+ * which completes the measurement.
+ *
+ * A key press which doesn't change the find text (arrows, Enter, and
+ * so on) doesn't start a measurement: the next key press replaces it.
+ *
+ * For each stage, the probe keeps a histogram of the latencies since
+ * the key press.
+ */
+class LatencyProbe
+{
+public:
+    enum class Stage {
+        TEXT_CHANGED,
+        FIND,
+        GRID_UPDATE,
+        PAINT,
+    };
+
+    static constexpr std::size_t stageCount = 4;
+
+    /*
+     * Number of histogram buckets: bucket i contains latencies within
+     * [2^(i - 1), 2^i) × `bucketUnit` (first bucket: [0, `bucketUnit`),
+     * last one: anything larger).
+     */
+    static constexpr std::size_t bucketCount = 12;
+    static constexpr std::chrono::microseconds bucketUnit {64};
+
+    // budget of a single frame
+    static constexpr std::chrono::microseconds frameBudget {16667};
+
+public:
+    void keyPressed();
+    void reached(Stage stage);
+
+    // drops the current measurement, if any (the window is hidden)
+    void cancel();
+
+    // one line summary of the last measurement, for an overlay
+    const std::string& lastText() const noexcept
+    {
+        return _lastText;
+    }
+
+    // complete report (all the stages and the total histogram)
+    std::string report() const;
+
+private:
+    using _Clock = std::chrono::steady_clock;
+
+    struct _StageStats
+    {
+        std::array<unsigned long long, bucketCount> buckets {};
+        unsigned long long count = 0;
+        std::chrono::microseconds sum {0};
+        std::chrono::microseconds max {0};
+    };
+
+private:
+    static std::size_t _bucketIndex(std::chrono::microseconds latency);
+    static const char *_stageName(Stage stage);
+    void _updateLastText(std::chrono::microseconds latency);
+
+private:
+    std::array<_StageStats, stageCount> _stageStats;
+
+    // last key press, if it didn't change the find text yet
+    _Clock::time_point _keyPressTime;
+    bool _keyPressPending = false;
+
+    // start of the current measurement, if any
+    _Clock::time_point _start;
+    bool _measuring = false;
+    std::string _lastText;
+};
+
+} // namespace jome
+
+#endif // _JOME_LATENCY_PROBE_HPP
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QPainter>
+#include <QFontMetrics>
+#include <algorithm>
+#include <array>
+
+#include "q-emoji-info-widget.hpp"
+#include "q-emojis-widget.hpp"
+
+namespace jome {
+
+// horizontal space between two skin tone variants
+static constexpr int skinToneSpacing = 8;
+
+// width of the five skin tone variants
+static constexpr int skinTonesWidth = 5 * (QEmojisWidget::emojiSize +
+                                           skinToneSpacing) - skinToneSpacing;
+
+QEmojiInfoWidget::QEmojiInfoWidget(QWidget * const parent,
+                                   const EmojiDb& emojiDb,
+                                   EmojiImages& emojiImages) :
+    QWidget {parent},
+    _emojiImages {&emojiImages}
+{
+    _staticTexts.resize(emojiDb.emojis().size());
+    this->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+}
+
+QSize QEmojiInfoWidget::sizeHint() const
+{
+    // the font is inherited from the window once it's a child
+    return {
+        0, std::max(QFontMetrics {this->font()}.height() + 4,
+                    QEmojisWidget::emojiSize + 4)
+    };
+}
+
+void QEmojiInfoWidget::showEmoji(const Emoji * const emoji)
+{
+    if (emoji == _emoji) {
+        return;
+    }
+
+    _emoji = emoji;
+    this->update();
+}
+
+void QEmojiInfoWidget::preferredSkinTone(const Emoji::SkinTone skinTone)
+{
+    if (skinTone == _preferredSkinTone) {
+        return;
+    }
+
+    _preferredSkinTone = skinTone;
+    this->update();
+}
+
+void QEmojiInfoWidget::trimCaches()
+{
+    for (auto& staticText : _staticTexts) {
+        if (!_emoji || &staticText != &_staticTexts[_emoji->index()]) {
+            staticText = QStaticText {};
+        }
+    }
+}
+
+const QStaticText& QEmojiInfoWidget::_staticTextForEmoji(const Emoji& emoji)
+{
+    auto& staticText = _staticTexts[emoji.index()];
+
+    if (!staticText.text().isEmpty()) {
+        return staticText;
+    }
+
+    QString text;
+
+    text += "<b>";
+    text += emoji.name().c_str();
+    text += "</b> <span style=\"color: #999\">(";
+
+    if (emoji.pack()) {
+        // the codepoints of `:NAME:` don't mean much
+        text += QString::fromStdString(emoji.pack()->name()).toHtmlEscaped();
+    } else {
+        for (const auto codepoint : emoji.codepoints()) {
+            text += QString::number(codepoint, 16) + ", ";
+        }
+
+        text.truncate(text.size() - 2);
+    }
+
+    text += ")</span>";
+    staticText.setTextFormat(Qt::RichText);
+    staticText.setText(text);
+    return staticText;
+}
+
+void QEmojiInfoWidget::paintEvent(QPaintEvent *)
+{
+    if (!_emoji) {
+        return;
+    }
+
+    QPainter painter {this};
+    const auto& staticText = this->_staticTextForEmoji(*_emoji);
+
+    if (_emoji->hasSkinToneSupport()) {
+        this->_paintSkinTones(painter);
+
+        // keep the text away from the variants
+        painter.setClipRect(QRect {
+            0, 0, this->width() - skinTonesWidth - skinToneSpacing,
+            this->height()
+        });
+    }
+
+    painter.setFont(this->font());
+    painter.setPen(QColor {"#ff3366"});
+    painter.drawStaticText(0, (this->height() -
+                               static_cast<int>(staticText.size().height())) / 2,
+                           staticText);
+}
+
+void QEmojiInfoWidget::_paintSkinTones(QPainter& painter)
+{
+    static constexpr std::array<Emoji::SkinTone, 5> skinTones {{
+        Emoji::SkinTone::LIGHT,
+        Emoji::SkinTone::MEDIUM_LIGHT,
+        Emoji::SkinTone::MEDIUM,
+        Emoji::SkinTone::MEDIUM_DARK,
+        Emoji::SkinTone::DARK,
+    }};
+
+    constexpr auto emojiSize = QEmojisWidget::emojiSize;
+
+    // right-aligned, light to dark (F1 to F5)
+    auto x = this->width() - skinTonesWidth;
+    const auto y = (this->height() - emojiSize) / 2;
+
+    for (const auto skinTone : skinTones) {
+        // variants are only loaded the first time they're drawn
+        _emojiImages->drawEmoji(painter, {x, y}, *_emoji, skinTone);
+
+        if (skinTone == _preferredSkinTone) {
+            painter.fillRect(x, y + emojiSize, emojiSize, 2,
+                             QColor {"#ff3366"});
+        }
+
+        x += emojiSize + skinToneSpacing;
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_EMOJI_INFO_WIDGET_HPP
+#define _JOME_Q_EMOJI_INFO_WIDGET_HPP
+
+#include <QWidget>
+#include <QStaticText>
+#include <vector>
+
+#include "emoji-db.hpp"
+#include "emoji-images.hpp"
+
+namespace jome {
+
+/*
+ * Shows the name and codepoints of a single emoji.
+ *
+ * The rich text of each emoji is only laid out the first time it's
+ * shown, then drawn from a cached static text.
+ *
+ * If the emoji supports skin tones, this widget also shows its five
+ * skin tone variants, from light to dark, underlining the preferred
+ * one.
+ */
+class QEmojiInfoWidget :
+    public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit QEmojiInfoWidget(QWidget *parent, const EmojiDb& emojiDb,
+                              EmojiImages& emojiImages);
+    void showEmoji(const Emoji *emoji);
+    void preferredSkinTone(Emoji::SkinTone skinTone);
+
+    // releases the static texts of the emojis which aren't shown
+    void trimCaches();
+    QSize sizeHint() const override;
+
+private:
+    void paintEvent(QPaintEvent *event) override;
+    const QStaticText& _staticTextForEmoji(const Emoji& emoji);
+    void _paintSkinTones(QPainter& painter);
+
+private:
+    EmojiImages * const _emojiImages;
+    const Emoji *_emoji = nullptr;
+    Emoji::SkinTone _preferredSkinTone = Emoji::SkinTone::NONE;
+
+    // static texts, indexed by emoji index (empty until needed)
+    std::vector<QStaticText> _staticTexts;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_EMOJI_INFO_WIDGET_HPP
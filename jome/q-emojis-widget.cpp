@@ -5,312 +5,931 @@
  * of the MIT license. See the LICENSE file for details.
  */
 
-#include <QVBoxLayout>
-#include <QHBoxLayout>
-#include <QGridLayout>
-#include <QLineEdit>
-#include <QScrollArea>
 #include <QScrollBar>
-#include <QListWidget>
-#include <QLabel>
-#include <QGraphicsTextItem>
-#include <QKeyEvent>
-#include <boost/algorithm/string.hpp>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QCursor>
+#include <algorithm>
+#include <cassert>
 
 #include "q-emojis-widget.hpp"
 
 namespace jome {
 
+// horizontal and vertical margin around the grid and between sections
+static constexpr int margin = 8;
+
+// width and height of an emoji cell, including its margin
+static constexpr int cellSize = 32 + 8;
+
+// height of a category header
+static constexpr int catHeaderHeight = 24;
+
+// size of the selection image around an emoji
+static constexpr int selSize = 40;
+
+// first row of `rows` which ends after `y`
+template <typename RowsT>
+static auto firstRowEndingAfter(const RowsT& rows, const int y)
+{
+    return std::upper_bound(std::begin(rows), std::end(rows), y,
+                            [](const int y, const auto& row) {
+        return y < row.y + cellSize;
+    });
+}
+
 QEmojisWidget::QEmojisWidget(QWidget * const parent,
-                             const EmojiDb& emojiDb) :
-    QGraphicsView {parent},
+                             const EmojiDb& emojiDb,
+                             EmojiImages& emojiImages,
+                             LatencyProbe * const latencyProbe) :
+    QAbstractScrollArea {parent},
     _emojiDb {&emojiDb},
-    _emojiImages {emojiDb}
+    _latencyProbe {latencyProbe},
+    _emojiImages {&emojiImages},
+    _selPixmap {QString::fromStdString(std::string {JOME_DATA_DIR} + "/sel.png")},
+    _catFont {"Hack, DejaVu Sans Mono, monospace", 10, QFont::Bold}
 {
-    _allEmojisGraphicsSceneSelectedItem = this->_createSelectedGraphicsItem();
-    _findEmojisGraphicsSceneSelectedItem = this->_createSelectedGraphicsItem();
-    this->_setGraphicsSceneStyle(_allEmojisGraphicsScene);
-    this->_setGraphicsSceneStyle(_findEmojisGraphicsScene);
-    this->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    // empty until rebuilt
+    _allEmojisLayout = &_allEmojisLayouts[0];
     this->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     this->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    this->viewport()->setMouseTracking(true);
+    QObject::connect(this->verticalScrollBar(), &QScrollBar::valueChanged,
+                     this, &QEmojisWidget::_vertScrollBarValueChanged);
+}
+
+void QEmojisWidget::rebuild()
+{
+    _hoveredEmojiIndex = boost::none;
+    _allEmojis.clear();
+
+    // forget the layouts of all the column counts
+    _allEmojisLayouts.clear();
+    _layoutColCount = this->_colCount();
+    _allEmojisLayout = &_allEmojisLayouts[_layoutColCount];
+
+    for (const auto& cat : _emojiDb->cats()) {
+        _allEmojisLayout->sections.push_back({
+            cat.get(), static_cast<unsigned int>(_allEmojis.size()),
+            static_cast<unsigned int>(cat->emojis().size()), 0, 0
+        });
+        _allEmojis.insert(std::end(_allEmojis), std::begin(cat->emojis()),
+                          std::end(cat->emojis()));
+    }
+
+    this->_updateAllEmojisLayout();
+    this->_updateFindLayout();
 }
 
-QEmojisWidget::~QEmojisWidget()
+void QEmojisWidget::updateCatEmojis(const EmojiCat& cat)
 {
+    auto& sections = _allEmojisLayout->sections;
+    const auto sectionIt = std::find_if(std::begin(sections),
+                                        std::end(sections),
+                                        [&cat](const _Section& section) {
+        return section.cat == &cat;
+    });
+
+    if (sectionIt == std::end(sections)) {
+        // not built yet
+        return;
+    }
+
     /*
-     * Those "selected" graphics scene items could be out of the
-     * scene currently, therefore owned by this.
+     * The selected and hovered indexes are within the previous emojis:
+     * forget them before replacing any emoji, and select the same
+     * index again once laid out.
      */
-    if (!_findEmojisGraphicsSceneSelectedItem->scene()) {
-        delete _findEmojisGraphicsSceneSelectedItem;
+    const auto selectedIndex = _showingAllEmojis ? _selectedEmojiIndex :
+                                                   boost::none;
+
+    if (_showingAllEmojis) {
+        _selectedEmojiIndex = boost::none;
+        _hoveredEmojiIndex = boost::none;
+    }
+
+    // replace the emojis of this section
+    auto& section = *sectionIt;
+    const auto oldCount = section.count;
+    const auto newCount = static_cast<unsigned int>(cat.emojis().size());
+    const auto emojisIt = std::begin(_allEmojis) + section.firstIndex;
+
+    if (newCount < oldCount) {
+        _allEmojis.erase(emojisIt + newCount, emojisIt + oldCount);
+    } else if (newCount > oldCount) {
+        _allEmojis.insert(emojisIt + oldCount, newCount - oldCount, nullptr);
     }
 
-    if (!_allEmojisGraphicsSceneSelectedItem->scene()) {
-        delete _allEmojisGraphicsSceneSelectedItem;
+    std::copy(std::begin(cat.emojis()), std::end(cat.emojis()),
+              std::begin(_allEmojis) + section.firstIndex);
+    section.count = newCount;
+
+    // shift the following sections by the emoji count difference
+    for (auto it = sectionIt + 1; it != std::end(sections); ++it) {
+        it->firstIndex = it->firstIndex + newCount - oldCount;
+    }
+
+    // the layouts of the other column counts are now stale
+    this->_forgetOtherAllEmojisLayouts();
+
+    this->_updateAllEmojisLayout();
+
+    if (_showingAllEmojis) {
+        this->_updateScrollBar();
+        this->viewport()->update();
+
+        if (_allEmojis.empty()) {
+            this->_selectEmoji(boost::none);
+        } else if (selectedIndex) {
+            this->_selectEmoji(std::min(*selectedIndex,
+                                        static_cast<unsigned int>(_allEmojis.size() - 1)));
+        }
     }
 }
 
-void QEmojisWidget::_setGraphicsSceneStyle(QGraphicsScene& gs)
+unsigned int QEmojisWidget::_colCount() const
 {
-    gs.setBackgroundBrush(QColor {"#f8f8f8"});
+    const auto colCount = (this->viewport()->width() - margin) / cellSize;
+
+    return static_cast<unsigned int>(std::max(colCount, 1));
 }
 
-QGraphicsPixmapItem *QEmojisWidget::_createSelectedGraphicsItem()
+void QEmojisWidget::_layOut(_Layout& layout, const bool withHeaders)
 {
-    const auto path = std::string {JOME_DATA_DIR} + "/sel.png";
+    /*
+     * Only lay out the sections here, which gives the exact height
+     * and category positions in O(categories): rows are built on
+     * demand (see _buildNextRow()), so that showing any number of
+     * emojis only builds the rows of the first screenful.
+     *
+     * Clearing keeps the capacity of the vectors, so laying out the
+     * same emojis again doesn't allocate.
+     */
+    layout.rows.clear();
+    layout.emojiRows.clear();
+    layout.nextRowSectionIndex = 0;
+    layout.nextRowLocalIndex = 0;
 
-    QImage image {QString::fromStdString(path)};
-    auto graphicsItem = new QGraphicsPixmapItem {
-        QPixmap::fromImage(std::move(image))
-    };
+    int y = margin;
+
+    for (auto& section : layout.sections) {
+        const auto rowCount = (section.count + _layoutColCount - 1) /
+                              _layoutColCount;
+
+        section.y = y;
+        section.emojisY = y;
 
-    graphicsItem->hide();
-    graphicsItem->setEnabled(false);
-    graphicsItem->setZValue(1000.);
-    return graphicsItem;
+        if (withHeaders) {
+            section.emojisY += catHeaderHeight;
+        }
+
+        y = section.emojisY + static_cast<int>(rowCount) * cellSize + margin;
+    }
+
+    // no margin after the last section
+    layout.height = y - margin;
 }
 
-void QEmojisWidget::rebuild()
+bool QEmojisWidget::_buildNextRow(_Layout& layout)
 {
-    if (_allEmojisGraphicsSceneSelectedItem->scene()) {
-        _allEmojisGraphicsScene.removeItem(_allEmojisGraphicsSceneSelectedItem);
+    while (layout.nextRowSectionIndex < layout.sections.size()) {
+        const auto& section = layout.sections[layout.nextRowSectionIndex];
+
+        if (layout.nextRowLocalIndex >= section.count) {
+            // next section
+            ++layout.nextRowSectionIndex;
+            layout.nextRowLocalIndex = 0;
+            continue;
+        }
+
+        const auto count = std::min(_layoutColCount,
+                                    section.count - layout.nextRowLocalIndex);
+        const auto y = section.emojisY +
+                       static_cast<int>(layout.nextRowLocalIndex /
+                                        _layoutColCount) * cellSize;
+
+        layout.emojiRows.insert(std::end(layout.emojiRows), count,
+                                static_cast<unsigned int>(layout.rows.size()));
+        layout.rows.push_back({
+            section.firstIndex + layout.nextRowLocalIndex, count, y
+        });
+        layout.nextRowLocalIndex += count;
+        return true;
     }
 
-    _allEmojisGraphicsScene.clear();
-    _allEmojisGraphicsScene.addItem(_allEmojisGraphicsSceneSelectedItem);
-    _allEmojiGraphicsItems.clear();
-    _catVertPositions.clear();
+    return false;
+}
 
-    qreal y = 8.;
+bool QEmojisWidget::_ensureRowCount(_Layout& layout, const std::size_t count)
+{
+    while (layout.rows.size() < count) {
+        if (!this->_buildNextRow(layout)) {
+            return false;
+        }
+    }
 
-    _allEmojisGraphicsScene.setSceneRect(0., 0.,
-                                         static_cast<qreal>(this->width()) - 8., 0.);
-    QFont font {"Hack, DejaVu Sans Mono, monospace", 10, QFont::Bold};
+    return true;
+}
 
-    for (const auto& cat : _emojiDb->cats()) {
-        auto item = _allEmojisGraphicsScene.addText(QString::fromStdString(cat->name()),
-                                                    font);
+void QEmojisWidget::_ensureRowsForY(_Layout& layout, const int y)
+{
+    while (layout.rows.empty() || layout.rows.back().y <= y) {
+        if (!this->_buildNextRow(layout)) {
+            return;
+        }
+    }
+}
 
-        item->setPos(8., y);
-        _catVertPositions[cat.get()] = y;
-        y += 24.;
-        this->_addEmojisToGraphicsScene(cat->emojis(),
-                                        _allEmojiGraphicsItems,
-                                        _allEmojisGraphicsScene, y);
-        y += 8.;
+/*
+ * Builds the rows of `layout` up to the one of the emoji at `index`,
+ * returning false if `layout` has no such emoji.
+ */
+bool QEmojisWidget::_ensureRowForEmoji(_Layout& layout,
+                                       const unsigned int index)
+{
+    if (layout.sections.empty() ||
+            index >= layout.sections.back().firstIndex +
+                     layout.sections.back().count) {
+        return false;
     }
 
-    y -= 8.;
-    _allEmojisGraphicsScene.setSceneRect(0., 0.,
-                                         static_cast<qreal>(this->width()) - 8., y);
+    while (layout.emojiRows.size() <= index) {
+        if (!this->_buildNextRow(layout)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QEmojisWidget::_updateAllEmojisLayout()
+{
+    this->_layOut(*_allEmojisLayout, true);
+    this->_updateCatVertPositions();
+}
+
+void QEmojisWidget::_updateCatVertPositions()
+{
+    for (const auto& section : _allEmojisLayout->sections) {
+        _catVertPositions[section.cat] = section.y;
+    }
+}
+
+void QEmojisWidget::_setColCount(const unsigned int colCount)
+{
+    // keep the first visible emoji at the same place within the viewport
+    auto& scrollBar = *this->verticalScrollBar();
+    auto& curLayout = this->_curLayout();
+    const auto scrollY = scrollBar.value();
+    boost::optional<unsigned int> anchorIndex;
+    int anchorDy = 0;
+
+    this->_ensureRowsForY(curLayout, scrollY);
+
+    const auto anchorRowIt = firstRowEndingAfter(curLayout.rows, scrollY);
+
+    if (anchorRowIt != std::end(curLayout.rows)) {
+        anchorIndex = anchorRowIt->firstIndex;
+        anchorDy = scrollY - anchorRowIt->y;
+    }
+
+    _layoutColCount = colCount;
+
+    /*
+     * Reuse the layout of all the emojis for this column count if it
+     * exists, including its rows built so far; otherwise lay out the
+     * same sections for this column count and keep it.
+     */
+    const auto it = _allEmojisLayouts.find(colCount);
+
+    if (it == std::end(_allEmojisLayouts)) {
+        auto& layout = _allEmojisLayouts[colCount];
+
+        layout.sections = _allEmojisLayout->sections;
+        _allEmojisLayout = &layout;
+        this->_layOut(layout, true);
+    } else {
+        _allEmojisLayout = &it->second;
+    }
+
+    this->_updateCatVertPositions();
+
+    // find results change often: lay them out again (rows are lazy)
+    this->_layOut(_findEmojisLayout, false);
+    this->_updateScrollBar();
+
+    auto& layout = this->_curLayout();
+
+    if (anchorIndex && this->_ensureRowForEmoji(layout, *anchorIndex)) {
+        scrollBar.setValue(layout.rows[layout.emojiRows[*anchorIndex]].y +
+                           anchorDy);
+    }
+
+    this->viewport()->update();
+}
+
+void QEmojisWidget::_updateFindLayout()
+{
+    /*
+     * Only the find results section: updating find results (on each
+     * keystroke) doesn't need to lay out the categories again, as the
+     * column count didn't change.
+     */
+    if (_layoutColCount == 0) {
+        _layoutColCount = this->_colCount();
+    }
+
+    this->_layOut(_findEmojisLayout, false);
+    this->_updateScrollBar();
+    this->viewport()->update();
+}
+
+void QEmojisWidget::_updateFindLayoutCount()
+{
+    auto& layout = _findEmojisLayout;
+    auto& section = layout.sections.front();
+
+    /*
+     * Keep the rows built so far, except a last partial row which
+     * now possibly has more emojis.
+     */
+    if (!layout.rows.empty() && layout.rows.back().count < _layoutColCount) {
+        layout.emojiRows.resize(layout.emojiRows.size() -
+                                layout.rows.back().count);
+        layout.rows.pop_back();
+    }
+
+    section.count = static_cast<unsigned int>(_findEmojis.size());
+    layout.nextRowSectionIndex = 0;
+    layout.nextRowLocalIndex = static_cast<unsigned int>(layout.emojiRows.size());
+    layout.height = section.emojisY +
+                    static_cast<int>((section.count + _layoutColCount - 1) /
+                                     _layoutColCount) * cellSize;
+    this->_updateScrollBar();
+    this->viewport()->update();
+}
+
+void QEmojisWidget::_updateScrollBar()
+{
+    const auto height = this->_curLayout().height;
+    const auto viewportHeight = this->viewport()->height();
+    auto& scrollBar = *this->verticalScrollBar();
+
+    scrollBar.setRange(0, std::max(0, height - viewportHeight));
+    scrollBar.setPageStep(viewportHeight);
+    scrollBar.setSingleStep(cellSize / 2);
 }
 
 void QEmojisWidget::showAllEmojis()
 {
-    _curEmojiGraphicsItems = _allEmojiGraphicsItems;
-    this->setScene(&_allEmojisGraphicsScene);
-    this->_selectEmojiGraphicsItem(0);
+    // indexes within the previous emojis
+    _selectedEmojiIndex = boost::none;
+    _hoveredEmojiIndex = boost::none;
+    _showingAllEmojis = true;
+    this->_updateScrollBar();
+    this->viewport()->update();
+
+    if (_allEmojis.empty()) {
+        this->_selectEmoji(boost::none);
+    } else {
+        this->_selectEmoji(0);
+    }
 }
 
 void QEmojisWidget::showFindResults(const std::vector<const Emoji *>& results)
 {
-    if (_findEmojisGraphicsSceneSelectedItem->scene()) {
-        _findEmojisGraphicsScene.removeItem(_findEmojisGraphicsSceneSelectedItem);
+    // indexes within the previous emojis
+    _selectedEmojiIndex = boost::none;
+    _hoveredEmojiIndex = boost::none;
+
+    // assigning keeps the capacity of `_findEmojis`
+    _findEmojis = results;
+    _findEmojisLayout.sections.clear();
+    _findEmojisLayout.sections.push_back({
+        nullptr, 0, static_cast<unsigned int>(_findEmojis.size()), 0, 0
+    });
+    _showingAllEmojis = false;
+    this->_updateFindLayout();
+
+    if (results.empty()) {
+        this->_selectEmoji(boost::none);
+    } else {
+        this->_selectEmoji(0);
     }
+}
 
-    _findEmojisGraphicsScene.clear();
-    _findEmojisGraphicsScene.addItem(_findEmojisGraphicsSceneSelectedItem);
-    _curEmojiGraphicsItems.clear();
+void QEmojisWidget::addFindResults(const std::vector<const Emoji *>& results)
+{
+    assert(!this->showingAllEmojis());
+    assert(results.size() >= _findEmojis.size());
 
-    qreal y = 0.;
+    const auto hadResults = !_findEmojis.empty();
 
-    _findEmojisGraphicsScene.setSceneRect(0., 0.,
-                                          static_cast<qreal>(this->width()) - 8., 0.);
+    // only add the results which we don't have yet
+    _findEmojis.insert(std::end(_findEmojis),
+                       std::begin(results) + _findEmojis.size(),
+                       std::end(results));
+    this->_updateFindLayoutCount();
 
-    if (!results.empty()) {
-        y = 8.;
-        this->_addEmojisToGraphicsScene(results, _curEmojiGraphicsItems,
-                                        _findEmojisGraphicsScene, y);
+    if (!hadResults && !results.empty()) {
+        this->_selectEmoji(0);
     }
+}
 
-    _findEmojisGraphicsScene.setSceneRect(0., 0.,
-                                          static_cast<qreal>(this->width()) - 8., y);
-    this->setScene(&_findEmojisGraphicsScene);
+unsigned int QEmojisWidget::pageEmojiCount() const
+{
+    const auto rowCount = this->viewport()->height() / cellSize + 1;
 
-    if (results.empty()) {
-        this->_selectEmojiGraphicsItem(boost::none);
+    return this->_colCount() * static_cast<unsigned int>(rowCount);
+}
+
+boost::optional<unsigned int> QEmojisWidget::_colForEmojiIndex(const unsigned int index)
+{
+    auto& layout = this->_curLayout();
+
+    if (!this->_ensureRowForEmoji(layout, index)) {
+        return boost::none;
+    }
+
+    return index - layout.rows[layout.emojiRows[index]].firstIndex;
+}
+
+boost::optional<QPoint> QEmojisWidget::_emojiCellPos(const unsigned int index)
+{
+    auto& layout = this->_curLayout();
+
+    if (!this->_ensureRowForEmoji(layout, index)) {
+        return boost::none;
+    }
+
+    const auto& row = layout.rows[layout.emojiRows[index]];
+
+    return QPoint {
+        margin + static_cast<int>(index - row.firstIndex) * cellSize, row.y
+    };
+}
+
+boost::optional<unsigned int> QEmojisWidget::_emojiIndexAt(const QPoint& viewportPos)
+{
+    auto& layout = this->_curLayout();
+    const auto& rows = layout.rows;
+    const auto x = viewportPos.x() - margin;
+    const auto y = viewportPos.y() + this->verticalScrollBar()->value();
+
+    this->_ensureRowsForY(layout, y);
+
+    if (x < 0 || x % cellSize >= emojiSize) {
+        return boost::none;
+    }
+
+    const auto col = static_cast<unsigned int>(x / cellSize);
+    const auto it = firstRowEndingAfter(rows, y);
+
+    if (it == std::end(rows) || y < it->y || y - it->y >= emojiSize) {
+        // header, margin, or after the last row
+        return boost::none;
+    }
+
+    if (col >= it->count) {
+        return boost::none;
+    }
+
+    return it->firstIndex + col;
+}
+
+const QStaticText& QEmojisWidget::_catHeaderText(const EmojiCat& cat)
+{
+    const auto it = _catHeaderTexts.find(&cat);
+
+    if (it != std::end(_catHeaderTexts)) {
+        return it->second;
+    }
+
+    // laid out once, then kept across rebuilds
+    auto& staticText = _catHeaderTexts[&cat];
+
+    staticText.setTextFormat(Qt::PlainText);
+    staticText.setText(QString::fromStdString(cat.name()));
+    staticText.prepare({}, _catFont);
+    return staticText;
+}
+
+void QEmojisWidget::paintEvent(QPaintEvent * const event)
+{
+    QPainter painter {this->viewport()};
+    const auto& rect = event->rect();
+    auto& layout = this->_curLayout();
+    const auto& emojis = this->_curEmojis();
+    const auto scrollY = this->verticalScrollBar()->value();
+    const auto top = rect.top() + scrollY;
+    const auto bottom = rect.bottom() + scrollY;
+
+    // build the rows of the visible area if not done yet
+    this->_ensureRowsForY(layout, bottom);
+
+    painter.fillRect(rect, QColor {"#f8f8f8"});
+    painter.setFont(_catFont);
+    painter.setPen(Qt::black);
+
+    // headers of the visible sections
+    auto sectionIt = std::upper_bound(std::begin(layout.sections),
+                                      std::end(layout.sections), top,
+                                      [](const int y, const _Section& section) {
+        return y < section.y;
+    });
+
+    if (sectionIt != std::begin(layout.sections)) {
+        --sectionIt;
+    }
+
+    for (; sectionIt != std::end(layout.sections) && sectionIt->y <= bottom;
+            ++sectionIt) {
+        if (sectionIt->cat) {
+            painter.drawStaticText(QPoint {
+                margin + 4, sectionIt->y + 4 - scrollY
+            }, this->_catHeaderText(*sectionIt->cat));
+        }
+    }
+
+    // visible rows
+    for (auto rowIt = firstRowEndingAfter(layout.rows, top);
+            rowIt != std::end(layout.rows) && rowIt->y <= bottom; ++rowIt) {
+        const auto y = rowIt->y - scrollY;
+
+        for (auto col = 0U; col < rowIt->count; ++col) {
+            const auto index = rowIt->firstIndex + col;
+            const auto& emoji = *emojis[index];
+
+            if (_hoveredEmojiIndex && *_hoveredEmojiIndex == index) {
+                painter.setOpacity(.5);
+            }
+
+            _emojiImages->drawEmoji(painter, {
+                margin + static_cast<int>(col) * cellSize, y
+            }, emoji, _skinTone);
+            painter.setOpacity(1.);
+        }
+    }
+
+    if (_selectedEmojiIndex) {
+        if (const auto pos = this->_emojiCellPos(*_selectedEmojiIndex)) {
+            painter.drawPixmap(pos->x() - 4, pos->y() - 4 - scrollY,
+                               _selPixmap);
+        }
+    }
+
+    if (_latencyProbe) {
+        this->_paintLatencyProbeOverlay(painter);
+    }
+}
+
+QRect QEmojisWidget::_latencyProbeOverlayRect() const
+{
+    constexpr auto height = 20;
+
+    return {
+        0, this->viewport()->height() - height,
+        this->viewport()->width(), height
+    };
+}
+
+void QEmojisWidget::_paintLatencyProbeOverlay(QPainter& painter)
+{
+    const auto prevText = _latencyProbe->lastText();
+
+    // this paint completes the current measurement, if any
+    _latencyProbe->reached(LatencyProbe::Stage::PAINT);
+
+    if (_latencyProbe->lastText() != prevText) {
+        // show the new measurement with the next paint
+        this->viewport()->update(this->_latencyProbeOverlayRect());
+        return;
+    }
+
+    const auto rect = this->_latencyProbeOverlayRect();
+
+    painter.fillRect(rect, QColor {0, 0, 0, 160});
+    painter.setPen(Qt::white);
+    painter.drawText(rect.adjusted(margin, 0, -margin, 0),
+                     Qt::AlignRight | Qt::AlignVCenter,
+                     QString::fromStdString(_latencyProbe->lastText()));
+}
+
+void QEmojisWidget::resizeEvent(QResizeEvent * const event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    const auto colCount = this->_colCount();
+
+    if (colCount != _layoutColCount && _layoutColCount != 0) {
+        this->_setColCount(colCount);
     } else {
-        this->_selectEmojiGraphicsItem(0);
+        this->_updateScrollBar();
     }
 }
 
-void QEmojisWidget::_emojiGraphicsItemHoverEntered(const QEmojiGraphicsItem& item)
+void QEmojisWidget::scrollContentsBy(int, int)
 {
-    emit this->emojiHoverEntered(item.emoji());
+    this->viewport()->update();
+
+    // what's under the mouse cursor changed
+    if (this->viewport()->underMouse()) {
+        this->_updateHoveredEmoji(this->viewport()->mapFromGlobal(QCursor::pos()));
+    }
 }
 
-void QEmojisWidget::_emojiGraphicsItemHoverLeaved(const QEmojiGraphicsItem& item)
+void QEmojisWidget::mouseMoveEvent(QMouseEvent * const event)
 {
-    emit this->emojiHoverLeaved(item.emoji());
+    this->_updateHoveredEmoji(event->pos());
+    QAbstractScrollArea::mouseMoveEvent(event);
 }
 
-void QEmojisWidget::_emojiGraphicsItemClicked(const QEmojiGraphicsItem& item)
+void QEmojisWidget::mousePressEvent(QMouseEvent * const event)
 {
-    emit this->emojiClicked(item.emoji());
+    if (event->button() == Qt::LeftButton) {
+        const auto index = this->_emojiIndexAt(event->pos());
+
+        if (index) {
+            emit this->emojiClicked(*this->_curEmojis()[*index]);
+        }
+    }
+
+    QAbstractScrollArea::mousePressEvent(event);
 }
 
-void QEmojisWidget::_selectEmojiGraphicsItem(const boost::optional<unsigned int>& index)
+bool QEmojisWidget::viewportEvent(QEvent * const event)
 {
-    QGraphicsPixmapItem *selectedItem = nullptr;
+    if (event->type() == QEvent::Leave) {
+        this->_updateHoveredEmoji({-1, -1});
+    }
 
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+void QEmojisWidget::_updateEmojiCell(const unsigned int index)
+{
+    const auto pos = this->_emojiCellPos(index);
+
+    if (!pos) {
+        return;
+    }
+
+    // include the selection image
+    this->viewport()->update(pos->x() - 4,
+                             pos->y() - 4 - this->verticalScrollBar()->value(),
+                             selSize, selSize);
+}
+
+void QEmojisWidget::_updateHoveredEmoji(const QPoint& viewportPos)
+{
+    const auto index = this->_emojiIndexAt(viewportPos);
+
+    if (index == _hoveredEmojiIndex) {
+        return;
+    }
+
+    const auto& emojis = this->_curEmojis();
+
+    if (_hoveredEmojiIndex) {
+        const auto& prevEmoji = *emojis[*_hoveredEmojiIndex];
+
+        this->_updateEmojiCell(*_hoveredEmojiIndex);
+        _hoveredEmojiIndex = boost::none;
+        emit this->emojiHoverLeaved(prevEmoji);
+    }
+
+    _hoveredEmojiIndex = index;
+
+    if (index) {
+        this->_updateEmojiCell(*index);
+        emit this->emojiHoverEntered(*emojis[*index]);
+    }
+}
+
+void QEmojisWidget::_vertScrollBarValueChanged(const int value)
+{
     if (this->showingAllEmojis()) {
-        selectedItem = _allEmojisGraphicsSceneSelectedItem;
-    } else {
-        selectedItem = _findEmojisGraphicsSceneSelectedItem;
+        return;
+    }
+
+    if (value >= this->verticalScrollBar()->maximum()) {
+        emit this->findResultsEndReached();
     }
+}
 
-    assert(selectedItem);
-    assert(selectedItem->scene());
-    _selectedEmojiGraphicsItemIndex = index;
+void QEmojisWidget::_selectEmoji(const boost::optional<unsigned int>& index)
+{
+    const auto& emojis = this->_curEmojis();
+
+    // the previous selection could be within other emojis
+    if (_selectedEmojiIndex && *_selectedEmojiIndex < emojis.size()) {
+        this->_updateEmojiCell(*_selectedEmojiIndex);
+    }
+
+    _selectedEmojiIndex = index;
 
     if (!index) {
-        selectedItem->hide();
         emit this->selectionChanged(nullptr);
         return;
     }
 
-    assert(*index < _curEmojiGraphicsItems.size());
-
-    const auto& emojiGraphicsItem = *_curEmojiGraphicsItems[*index];
-
-    selectedItem->show();
-    selectedItem->setPos(emojiGraphicsItem.pos().x() - 4.,
-                         emojiGraphicsItem.pos().y() - 4.);
+    assert(*index < emojis.size());
+    this->_updateEmojiCell(*index);
 
     if (*index == 0) {
         this->verticalScrollBar()->setValue(0);
     } else {
-        const auto candY = selectedItem->pos().y() + 16. -
-                           static_cast<qreal>(this->height()) / 2.;
-        const auto y = std::max(0., candY);
+        // `*index` is within the current emojis: it has a cell
+        const auto selY = this->_emojiCellPos(*index)->y() - 4;
+        const auto candY = selY + 16 - this->viewport()->height() / 2;
 
-        this->verticalScrollBar()->setValue(static_cast<int>(y));
+        this->verticalScrollBar()->setValue(std::max(0, candY));
     }
 
-    emit this->selectionChanged(&emojiGraphicsItem.emoji());
+    emit this->selectionChanged(emojis[*index]);
+
+    if (!this->showingAllEmojis() &&
+            emojis.size() - *index <= 2 * _layoutColCount) {
+        // selection is within the last two rows: want more
+        emit this->findResultsEndReached();
+    }
 }
 
 void QEmojisWidget::scrollToCat(const EmojiCat& cat)
 {
-    if (_catVertPositions.empty()) {
+    const auto it = _catVertPositions.find(&cat);
+
+    if (it == std::end(_catVertPositions)) {
         return;
     }
 
-    const auto y = std::max(0., _catVertPositions[&cat] - 8);
-
-    this->verticalScrollBar()->setValue(static_cast<int>(y));
+    this->verticalScrollBar()->setValue(std::max(0, it->second - margin));
 }
 
 void QEmojisWidget::selectNext(const unsigned int count)
 {
-    if (!_selectedEmojiGraphicsItemIndex) {
+    if (!_selectedEmojiIndex) {
         return;
     }
 
-    for (auto i = 0U; i < count; i++) {
-        if (*_selectedEmojiGraphicsItemIndex + 1 == _curEmojiGraphicsItems.size()) {
-            return;
-        }
+    const auto lastIndex = static_cast<unsigned int>(this->_curEmojis().size() - 1);
 
-        this->_selectEmojiGraphicsItem(*_selectedEmojiGraphicsItemIndex + 1);
-    }
+    this->_selectEmoji(*_selectedEmojiIndex +
+                       std::min(count, lastIndex - *_selectedEmojiIndex));
 }
 
 void QEmojisWidget::selectPrevious(const unsigned int count)
 {
-    if (!_selectedEmojiGraphicsItemIndex) {
+    if (!_selectedEmojiIndex) {
         return;
     }
 
-    for (auto i = 0U; i < count; i++) {
-        if (*_selectedEmojiGraphicsItemIndex == 0) {
-            return;
-        }
-
-        this->_selectEmojiGraphicsItem(*_selectedEmojiGraphicsItemIndex - 1);
-    }
+    this->_selectEmoji(*_selectedEmojiIndex -
+                       std::min(count, *_selectedEmojiIndex));
 }
 
 void QEmojisWidget::selectPreviousRow(const unsigned int count)
 {
-    if (!_selectedEmojiGraphicsItemIndex) {
+    if (!_selectedEmojiIndex) {
+        return;
+    }
+
+    auto& layout = this->_curLayout();
+    const auto optCol = this->_colForEmojiIndex(*_selectedEmojiIndex);
+
+    if (!optCol) {
         return;
     }
 
-    const auto& selectedEmojiGraphicsItem = *_curEmojiGraphicsItems[*_selectedEmojiGraphicsItemIndex];
-    const auto curX = selectedEmojiGraphicsItem.pos().x();
-    auto index = *_selectedEmojiGraphicsItemIndex;
+    const auto col = *optCol;
+    auto rowIndex = layout.emojiRows[*_selectedEmojiIndex];
+    auto index = *_selectedEmojiIndex;
 
+    /*
+     * Move up `count` times to the previous row having a cell at the
+     * current column (the last row of a section can be shorter).
+     */
     for (auto i = 0U; i < count; i++) {
-        for (auto eI = static_cast<int>(index) - 1; eI >= 0; --eI) {
-            const auto& emojiGraphicsItem = *_curEmojiGraphicsItems[eI];
+        auto candRowIndex = rowIndex;
 
-            if (emojiGraphicsItem.pos().x() == curX) {
-                index = static_cast<unsigned int>(eI);
-                break;
-            }
+        while (candRowIndex > 0 && layout.rows[candRowIndex - 1].count <= col) {
+            --candRowIndex;
         }
+
+        if (candRowIndex == 0) {
+            break;
+        }
+
+        rowIndex = candRowIndex - 1;
+        index = layout.rows[rowIndex].firstIndex + col;
     }
 
-    this->_selectEmojiGraphicsItem(index);
+    this->_selectEmoji(index);
 }
 
 void QEmojisWidget::selectNextRow(const unsigned int count)
 {
-    if (!_selectedEmojiGraphicsItemIndex) {
+    if (!_selectedEmojiIndex) {
+        return;
+    }
+
+    auto& layout = this->_curLayout();
+    const auto optCol = this->_colForEmojiIndex(*_selectedEmojiIndex);
+
+    if (!optCol) {
         return;
     }
 
-    const auto& selectedEmojiGraphicsItem = *_curEmojiGraphicsItems[*_selectedEmojiGraphicsItemIndex];
-    const auto curX = selectedEmojiGraphicsItem.pos().x();
-    auto index = *_selectedEmojiGraphicsItemIndex;
+    const auto col = *optCol;
+    auto rowIndex = layout.emojiRows[*_selectedEmojiIndex];
+    auto index = *_selectedEmojiIndex;
 
+    /*
+     * Move down `count` times to the next row having a cell at the
+     * current column (the last row of a section can be shorter).
+     */
     for (auto i = 0U; i < count; i++) {
-        for (auto eI = index + 1; eI < _curEmojiGraphicsItems.size(); ++eI) {
-            const auto& emojiGraphicsItem = *_curEmojiGraphicsItems[eI];
+        std::size_t candRowIndex = rowIndex + 1;
 
-            if (emojiGraphicsItem.pos().x() == curX) {
-                index = eI;
-                break;
-            }
+        while (this->_ensureRowCount(layout, candRowIndex + 1) &&
+                layout.rows[candRowIndex].count <= col) {
+            ++candRowIndex;
+        }
+
+        if (candRowIndex >= layout.rows.size()) {
+            break;
         }
+
+        rowIndex = static_cast<unsigned int>(candRowIndex);
+        index = layout.rows[candRowIndex].firstIndex + col;
     }
 
-    this->_selectEmojiGraphicsItem(index);
+    this->_selectEmoji(index);
 }
 
 void QEmojisWidget::selectFirst()
 {
-    if (_curEmojiGraphicsItems.empty()) {
+    if (this->_curEmojis().empty()) {
         return;
     }
 
-    this->_selectEmojiGraphicsItem(0);
+    this->_selectEmoji(0);
 }
 
 void QEmojisWidget::selectLast()
 {
-    if (_curEmojiGraphicsItems.empty()) {
+    if (this->_curEmojis().empty()) {
         return;
     }
 
-    this->_selectEmojiGraphicsItem(_curEmojiGraphicsItems.size() - 1);
+    this->_selectEmoji(this->_curEmojis().size() - 1);
+}
+
+bool QEmojisWidget::showingAllEmojis() const
+{
+    return _showingAllEmojis;
 }
 
-bool QEmojisWidget::showingAllEmojis()
+void QEmojisWidget::_forgetOtherAllEmojisLayouts()
 {
-    return this->scene() == &_allEmojisGraphicsScene;
+    for (auto it = std::begin(_allEmojisLayouts);
+            it != std::end(_allEmojisLayouts);) {
+        if (&it->second == _allEmojisLayout) {
+            ++it;
+        } else {
+            it = _allEmojisLayouts.erase(it);
+        }
+    }
+}
+
+void QEmojisWidget::trimCaches()
+{
+    if (!_showingAllEmojis) {
+        return;
+    }
+
+    // keep the current layout so that showing again is only painting
+    this->_forgetOtherAllEmojisLayouts();
+
+    /*
+     * Keep the capacity of the find results and of their layout (a
+     * pointer and a row index per emoji at most) so that the next
+     * keystroke still doesn't allocate.
+     */
+    _findEmojis.clear();
+    _findEmojisLayout.sections.clear();
+    this->_layOut(_findEmojisLayout, false);
+}
+
+void QEmojisWidget::skinTone(const Emoji::SkinTone skinTone)
+{
+    if (skinTone == _skinTone) {
+        return;
+    }
+
+    _skinTone = skinTone;
+    this->viewport()->update();
 }
 
 } // namespace jome
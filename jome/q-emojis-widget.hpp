@@ -11,32 +11,51 @@
 #include <QObject>
 #include <QEvent>
 #include <QPixmap>
-#include <QGraphicsScene>
-#include <QGraphicsView>
+#include <QFont>
+#include <QAbstractScrollArea>
+#include <QPainter>
+#include <QRect>
+#include <QStaticText>
 #include <boost/optional.hpp>
-#include <functional>
+#include <vector>
 
 #include "emoji-db.hpp"
 #include "emoji-images.hpp"
-#include "q-emoji-graphics-item.hpp"
+#include "latency-probe.hpp"
 
 namespace jome {
 
+/*
+ * Virtualized grid of emojis.
+ *
+ * The grid is a sequence of sections: one per category when showing
+ * all the emojis, or a single one, without a header, when showing find
+ * results. The position of an emoji cell is an arithmetic function of
+ * its index, of the section containing it, and of the column count;
+ * painting and hit-testing only consider what's within the viewport.
+ */
 class QEmojisWidget :
-    public QGraphicsView
+    public QAbstractScrollArea
 {
     Q_OBJECT
-    friend class QEmojiGraphicsItem;
 
 public:
-    using CatVerticalPositions = std::unordered_map<const EmojiCat *, qreal>;
+    using CatVerticalPositions = std::unordered_map<const EmojiCat *, int>;
+
+public:
+    // size of an emoji image within its cell
+    static constexpr int emojiSize = 32;
 
 public:
-    explicit QEmojisWidget(QWidget *parent, const EmojiDb& emojiDb);
-    ~QEmojisWidget();
+    explicit QEmojisWidget(QWidget *parent, const EmojiDb& emojiDb,
+                           EmojiImages& emojiImages,
+                           LatencyProbe *latencyProbe = nullptr);
     void rebuild();
+    void updateCatEmojis(const EmojiCat& cat);
     void showAllEmojis();
     void showFindResults(const std::vector<const Emoji *>& results);
+    void addFindResults(const std::vector<const Emoji *>& results);
+    unsigned int pageEmojiCount() const;
     void selectNext(unsigned int count = 1);
     void selectPrevious(unsigned int count = 1);
     void selectPreviousRow(unsigned int count = 1);
@@ -44,67 +63,166 @@ public:
     void selectFirst();
     void selectLast();
     void scrollToCat(const EmojiCat& cat);
-    bool showingAllEmojis();
+    bool showingAllEmojis() const;
+
+    /*
+     * Sets the skin tone with which to draw the emojis which support
+     * skin tones.
+     */
+    void skinTone(Emoji::SkinTone skinTone);
+
+    /*
+     * Releases the layouts of all the emojis for other column counts
+     * and forgets the find results, keeping the capacity of their
+     * vectors.
+     *
+     * Only does something when showing all the emojis.
+     */
+    void trimCaches();
 
 signals:
     void selectionChanged(const Emoji *emoji);
     void emojiHoverEntered(const Emoji& emoji);
     void emojiHoverLeaved(const Emoji& emoji);
     void emojiClicked(const Emoji& emoji);
+    void findResultsEndReached();
 
 private:
-    void _selectEmojiGraphicsItem(const boost::optional<unsigned int>& index);
-    QGraphicsPixmapItem *_createSelectedGraphicsItem();
-    void _setGraphicsSceneStyle(QGraphicsScene& gs);
-    void _emojiGraphicsItemHoverEntered(const QEmojiGraphicsItem& item);
-    void _emojiGraphicsItemHoverLeaved(const QEmojiGraphicsItem& item);
-    void _emojiGraphicsItemClicked(const QEmojiGraphicsItem& item);
+    // section of the grid
+    struct _Section
+    {
+        // category (`nullptr` for find results)
+        const EmojiCat *cat;
+
+        // index of the first emoji of this section within the current emojis
+        unsigned int firstIndex;
+
+        // number of emojis of this section
+        unsigned int count;
+
+        // vertical position of the header (or first row if no header)
+        int y;
+
+        // vertical position of the first row
+        int emojisY;
+    };
+
+    // row of the grid
+    struct _Row
+    {
+        // index of the first emoji of this row within the current emojis
+        unsigned int firstIndex;
+
+        // number of emojis of this row
+        unsigned int count;
+
+        // vertical position
+        int y;
+    };
+
+    // layout of the emojis of a view, for a given column count
+    struct _Layout
+    {
+        std::vector<_Section> sections;
+
+        // rows of all the sections, in display order, built so far
+        std::vector<_Row> rows;
+
+        // row index of each emoji (indexed by emoji index)
+        std::vector<unsigned int> emojiRows;
+
+        /*
+         * Section index and emoji index within this section of the
+         * next row to build (rows are built on demand).
+         */
+        std::size_t nextRowSectionIndex = 0;
+        unsigned int nextRowLocalIndex = 0;
+
+        // total height
+        int height = 0;
+    };
 
 private:
-    template <typename ContainerT>
-    void _addEmojisToGraphicsScene(const ContainerT& emojis,
-                                   std::vector<QEmojiGraphicsItem *>& emojiGraphicsItems,
-                                   QGraphicsScene& gs,
-                                   qreal& y)
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void _selectEmoji(const boost::optional<unsigned int>& index);
+    void _setColCount(unsigned int colCount);
+    void _updateAllEmojisLayout();
+    void _forgetOtherAllEmojisLayouts();
+    void _updateCatVertPositions();
+    void _updateFindLayout();
+    void _updateFindLayoutCount();
+    void _layOut(_Layout& layout, bool withHeaders);
+    bool _buildNextRow(_Layout& layout);
+    bool _ensureRowCount(_Layout& layout, std::size_t count);
+    void _ensureRowsForY(_Layout& layout, int y);
+    bool _ensureRowForEmoji(_Layout& layout, unsigned int index);
+    void _updateScrollBar();
+    void _updateHoveredEmoji(const QPoint& viewportPos);
+    void _updateEmojiCell(unsigned int index);
+    void _paintLatencyProbeOverlay(QPainter& painter);
+    const QStaticText& _catHeaderText(const EmojiCat& cat);
+    QRect _latencyProbeOverlayRect() const;
+    unsigned int _colCount() const;
+    boost::optional<unsigned int> _colForEmojiIndex(unsigned int index);
+    boost::optional<QPoint> _emojiCellPos(unsigned int index);
+    boost::optional<unsigned int> _emojiIndexAt(const QPoint& viewportPos);
+
+    const std::vector<const Emoji *>& _curEmojis() const noexcept
+    {
+        return _showingAllEmojis ? _allEmojis : _findEmojis;
+    }
+
+    const _Layout& _curLayout() const noexcept
+    {
+        return _showingAllEmojis ? *_allEmojisLayout : _findEmojisLayout;
+    }
+
+    _Layout& _curLayout() noexcept
     {
-        qreal col = 0.;
-        const auto availWidth = gs.width();
-        constexpr auto emojiWidthAndMargin = 32. + 8.;
-
-        for (const auto& emoji : emojis) {
-            namespace ph = std::placeholders;
-
-            auto emojiGraphicsItem = new QEmojiGraphicsItem {
-                *emoji, _emojiImages.pixmapForEmoji(*emoji), *this
-            };
-
-            emojiGraphicsItems.push_back(emojiGraphicsItem);
-            emojiGraphicsItem->setPos(col * emojiWidthAndMargin + 8., y);
-            gs.addItem(emojiGraphicsItem);
-            col += 1;
-
-            if ((col + 1.) * emojiWidthAndMargin + 8. >= availWidth) {
-                col = 0.;
-                y += emojiWidthAndMargin;
-            }
-        }
-
-        if (col != 0.) {
-            y += emojiWidthAndMargin;
-        }
+        return _showingAllEmojis ? *_allEmojisLayout : _findEmojisLayout;
     }
 
+private slots:
+    void _vertScrollBarValueChanged(int value);
+
 private:
     const EmojiDb * const _emojiDb;
-    const EmojiImages _emojiImages;
-    QGraphicsScene _allEmojisGraphicsScene;
-    QGraphicsScene _findEmojisGraphicsScene;
+
+    // latency probe (`nullptr` if disabled)
+    LatencyProbe * const _latencyProbe;
+
+    EmojiImages * const _emojiImages;
+    const QPixmap _selPixmap;
+    const QFont _catFont;
+    bool _showingAllEmojis = true;
+    Emoji::SkinTone _skinTone = Emoji::SkinTone::NONE;
+
+    // all the emojis of all the categories, in display order
+    std::vector<const Emoji *> _allEmojis;
+
+    /*
+     * Layouts of all the emojis for each column count used so far, and
+     * current one.
+     */
+    std::unordered_map<unsigned int, _Layout> _allEmojisLayouts;
+    _Layout *_allEmojisLayout;
+
+    // current find results
+    std::vector<const Emoji *> _findEmojis;
+    _Layout _findEmojisLayout;
+
     CatVerticalPositions _catVertPositions;
-    std::vector<QEmojiGraphicsItem *> _curEmojiGraphicsItems;
-    std::vector<QEmojiGraphicsItem *> _allEmojiGraphicsItems;
-    boost::optional<unsigned int> _selectedEmojiGraphicsItemIndex;
-    QGraphicsPixmapItem *_allEmojisGraphicsSceneSelectedItem = nullptr;
-    QGraphicsPixmapItem *_findEmojisGraphicsSceneSelectedItem = nullptr;
+
+    // header text of each category shown so far
+    std::unordered_map<const EmojiCat *, QStaticText> _catHeaderTexts;
+    unsigned int _layoutColCount = 0;
+    boost::optional<unsigned int> _selectedEmojiIndex;
+    boost::optional<unsigned int> _hoveredEmojiIndex;
 };
 
 } // namespace jome
@@ -67,6 +67,9 @@ void QJomeServer::_socketReadyRead()
             } else if (_tmpData == "quit") {
                 emit clientRequested(Command::QUIT);
                 _tmpData.clear();
+            } else if (_tmpData == "stats") {
+                emit clientRequested(Command::STATS);
+                _tmpData.clear();
             }
 
             continue;
@@ -23,6 +23,7 @@ public:
     enum class Command {
         PICK,
         QUIT,
+        STATS,
     };
 
 public:
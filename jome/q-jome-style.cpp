@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QStyleOption>
+#include <QPainter>
+#include <algorithm>
+
+#include "q-jome-style.hpp"
+
+namespace jome {
+
+// width of a scroll bar
+static constexpr int scrollBarExtent = 8;
+
+// minimum length of a scroll bar slider
+static constexpr int scrollBarSliderMinLen = 16;
+
+// height and color of the bottom border of a line edit
+static constexpr int lineEditBorderHeight = 2;
+static constexpr auto lineEditBorderColor = "#ff3366";
+
+QJomeStyle::QJomeStyle() :
+    QProxyStyle {}
+{
+}
+
+int QJomeStyle::pixelMetric(const PixelMetric metric,
+                            const QStyleOption * const option,
+                            const QWidget * const widget) const
+{
+    switch (metric) {
+    case PM_ScrollBarExtent:
+        return scrollBarExtent;
+
+    case PM_ScrollBarSliderMin:
+        return scrollBarSliderMinLen;
+
+    case PM_DefaultFrameWidth:
+        return 0;
+
+    default:
+        return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+}
+
+QRect QJomeStyle::subControlRect(const ComplexControl control,
+                                 const QStyleOptionComplex * const option,
+                                 const SubControl subControl,
+                                 const QWidget * const widget) const
+{
+    const auto sliderOption = qstyleoption_cast<const QStyleOptionSlider *>(option);
+
+    if (control != CC_ScrollBar || !sliderOption) {
+        return QProxyStyle::subControlRect(control, option, subControl,
+                                           widget);
+    }
+
+    // no buttons: the groove is the whole scroll bar
+    const auto& rect = option->rect;
+    const auto isHoriz = sliderOption->orientation == Qt::Horizontal;
+    const auto len = isHoriz ? rect.width() : rect.height();
+    const auto range = sliderOption->maximum - sliderOption->minimum;
+    auto sliderLen = len;
+
+    if (range > 0) {
+        sliderLen = static_cast<int>(static_cast<qint64>(len) *
+                                     sliderOption->pageStep /
+                                     (range + sliderOption->pageStep));
+        sliderLen = std::min(std::max(sliderLen, scrollBarSliderMinLen), len);
+    }
+
+    const auto sliderPos = QStyle::sliderPositionFromValue(sliderOption->minimum,
+                                                           sliderOption->maximum,
+                                                           sliderOption->sliderPosition,
+                                                           len - sliderLen,
+                                                           sliderOption->upsideDown);
+
+    // rectangle from `begin` to `end` along the scroll bar
+    const auto partRect = [&rect, isHoriz](const int begin, const int end) {
+        if (isHoriz) {
+            return QRect {rect.x() + begin, rect.y(), end - begin,
+                          rect.height()};
+        }
+
+        return QRect {rect.x(), rect.y() + begin, rect.width(),
+                      end - begin};
+    };
+
+    switch (subControl) {
+    case SC_ScrollBarGroove:
+        return rect;
+
+    case SC_ScrollBarSlider:
+        return partRect(sliderPos, sliderPos + sliderLen);
+
+    case SC_ScrollBarSubPage:
+        return partRect(0, sliderPos);
+
+    case SC_ScrollBarAddPage:
+        return partRect(sliderPos + sliderLen, len);
+
+    default:
+        // no buttons
+        return {};
+    }
+}
+
+void QJomeStyle::drawComplexControl(const ComplexControl control,
+                                    const QStyleOptionComplex * const option,
+                                    QPainter * const painter,
+                                    const QWidget * const widget) const
+{
+    if (control != CC_ScrollBar) {
+        QProxyStyle::drawComplexControl(control, option, painter, widget);
+        return;
+    }
+
+    painter->fillRect(option->rect, QColor {"#666"});
+    painter->fillRect(this->subControlRect(control, option,
+                                           SC_ScrollBarSlider, widget),
+                      QColor {"#999"});
+}
+
+void QJomeStyle::drawPrimitive(const PrimitiveElement elem,
+                               const QStyleOption * const option,
+                               QPainter * const painter,
+                               const QWidget * const widget) const
+{
+    switch (elem) {
+    case PE_PanelLineEdit:
+    {
+        const auto& rect = option->rect;
+
+        painter->fillRect(rect, option->palette.color(QPalette::Base));
+        painter->fillRect(rect.x(), rect.bottom() - lineEditBorderHeight + 1,
+                          rect.width(), lineEditBorderHeight,
+                          QColor {lineEditBorderColor});
+        break;
+    }
+
+    case PE_FrameLineEdit:
+        // no frame
+        break;
+
+    default:
+        QProxyStyle::drawPrimitive(elem, option, painter, widget);
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_JOME_STYLE_HPP
+#define _JOME_Q_JOME_STYLE_HPP
+
+#include <QProxyStyle>
+
+namespace jome {
+
+/*
+ * Style of jome, on top of the default style.
+ *
+ * This style only draws what the palettes of the widgets can't
+ * express: flat, thin scroll bars without buttons, and line edits with
+ * a single bottom border.
+ */
+class QJomeStyle :
+    public QProxyStyle
+{
+    Q_OBJECT
+
+public:
+    explicit QJomeStyle();
+    int pixelMetric(PixelMetric metric, const QStyleOption *option,
+                    const QWidget *widget) const override;
+    QRect subControlRect(ComplexControl control,
+                         const QStyleOptionComplex *option,
+                         SubControl subControl,
+                         const QWidget *widget) const override;
+    void drawComplexControl(ComplexControl control,
+                            const QStyleOptionComplex *option,
+                            QPainter *painter,
+                            const QWidget *widget) const override;
+    void drawPrimitive(PrimitiveElement elem, const QStyleOption *option,
+                       QPainter *painter,
+                       const QWidget *widget) const override;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_JOME_STYLE_HPP
@@ -12,18 +12,21 @@
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QListWidget>
-#include <QLabel>
-#include <QGraphicsTextItem>
 #include <QKeyEvent>
-#include <boost/algorithm/string.hpp>
+#include <QPalette>
+#include <QMetaObject>
+#include <limits>
+#include <boost/optional.hpp>
 
 #include "q-jome-window.hpp"
 #include "q-cat-list-widget-item.hpp"
 
 namespace jome {
 
-QSearchBoxEventFilter::QSearchBoxEventFilter(QObject * const parent) :
-    QObject {parent}
+QSearchBoxEventFilter::QSearchBoxEventFilter(QObject * const parent,
+                                             LatencyProbe * const latencyProbe) :
+    QObject {parent},
+    _latencyProbe {latencyProbe}
 {
 }
 
@@ -36,6 +39,33 @@ bool QSearchBoxEventFilter::eventFilter(QObject * const obj,
 
     auto keyEvent = static_cast<const QKeyEvent *>(event);
 
+    if (keyEvent->modifiers() & Qt::ControlModifier) {
+        switch (keyEvent->key()) {
+        case Qt::Key_F1:
+            emit this->preferredSkinToneKeyPressed(Emoji::SkinTone::LIGHT);
+            return true;
+
+        case Qt::Key_F2:
+            emit this->preferredSkinToneKeyPressed(Emoji::SkinTone::MEDIUM_LIGHT);
+            return true;
+
+        case Qt::Key_F3:
+            emit this->preferredSkinToneKeyPressed(Emoji::SkinTone::MEDIUM);
+            return true;
+
+        case Qt::Key_F4:
+            emit this->preferredSkinToneKeyPressed(Emoji::SkinTone::MEDIUM_DARK);
+            return true;
+
+        case Qt::Key_F5:
+            emit this->preferredSkinToneKeyPressed(Emoji::SkinTone::DARK);
+            return true;
+
+        default:
+            break;
+        }
+    }
+
     switch (keyEvent->key()) {
     case Qt::Key_Up:
         emit this->upKeyPressed();
@@ -95,66 +125,63 @@ bool QSearchBoxEventFilter::eventFilter(QObject * const obj,
         break;
 
     default:
+        // any other key could change the text
+        if (_latencyProbe) {
+            _latencyProbe->keyPressed();
+        }
+
         return QObject::eventFilter(obj, event);
     }
 
     return true;
 }
 
-QJomeWindow::QJomeWindow(const EmojiDb& emojiDb) :
-    QDialog {},
-    _emojiDb {&emojiDb}
+QJomeWindow::QJomeWindow(const EmojiDb& emojiDb,
+                         const boost::optional<EmojiImages::FontSource>& emojiFontSource,
+                         const boost::optional<EmojiImages::SvgSource>& emojiSvgSource,
+                         LatencyProbe * const latencyProbe) :
+    QPickerWindow {latencyProbe},
+    _emojiDb {&emojiDb},
+    _emojiImages {
+        emojiDb, QEmojisWidget::emojiSize, this->devicePixelRatioF(),
+        emojiFontSource, emojiSvgSource
+    }
 {
-    this->setWindowTitle("jome");
-    this->setFixedSize(800, 600);
-    this->setWindowFlags(Qt::Dialog | Qt::MSWindowsFixedSizeDialogHint);
-    this->_setMainStyleSheet();
+    /*
+     * Reserve everything which could grow while the user types so that
+     * finding emojis and showing the results don't allocate.
+     */
+    _findResults.reserve(emojiDb.emojis().size());
     this->_buildUi();
+    this->_setPalettesAndFonts();
+
+    // called from a worker thread
+    _emojiImages.imagesReadyFunc([this]() {
+        QMetaObject::invokeMethod(this, "_emojiImagesReady",
+                                  Qt::QueuedConnection);
+    });
+
+    const auto skinToneVal = _settings.value("preferred-skin-tone", 0).toInt();
+
+    if (skinToneVal >= 0 && skinToneVal <= static_cast<int>(Emoji::SkinTone::DARK)) {
+        this->_setPreferredSkinTone(static_cast<Emoji::SkinTone>(skinToneVal));
+    }
 }
 
-void QJomeWindow::_setMainStyleSheet()
-{
-    static const char * const styleSheet =
-        "* {"
-        "  font-family: 'Hack', 'DejaVu Sans Mono', monospace;"
-        "  font-size: 12px;"
-        "  border: none;"
-        "}"
-        "QDialog {"
-        "  background-color: #333;"
-        "}"
-        "QLineEdit {"
-        "  background-color: rgba(0, 0, 0, 0.2);"
-        "  color: #f0f0f0;"
-        "  font-weight: bold;"
-        "  font-size: 14px;"
-        "  border-bottom: 2px solid #ff3366;"
-        "  padding: 4px;"
-        "}"
-        "QListWidget {"
-        "  background-color: transparent;"
-        "  color: #e0e0e0;"
-        "}"
-        "QScrollBar:vertical {"
-        "  border: none;"
-        "  background-color: #666;"
-        "  width: 8px;"
-        "  margin: 0;"
-        "}"
-        "QScrollBar::handle:vertical {"
-        "  border: none;"
-        "  background-color: #999;"
-        "  min-height: 16px;"
-        "}"
-        "QScrollBar::add-line:vertical,"
-        "QScrollBar::sub-line:vertical {"
-        "  height: 0;"
-        "}"
-        "QLabel {"
-        "  color: #ff3366;"
-        "}";
-
-    this->setStyleSheet(styleSheet);
+void QJomeWindow::_setPalettesAndFonts()
+{
+    this->_setCommonPalettesAndFonts();
+
+    // category list
+    _wCatList->setFrameShape(QFrame::NoFrame);
+
+    auto palette = _wCatList->palette();
+    palette.setColor(QPalette::Base, Qt::transparent);
+    palette.setColor(QPalette::Text, QColor {"#e0e0e0"});
+    _wCatList->setPalette(palette);
+
+    // emojis
+    _wEmojis->setFrameShape(QFrame::NoFrame);
 }
 
 QListWidget *QJomeWindow::_createCatListWidget()
@@ -176,11 +203,10 @@ QListWidget *QJomeWindow::_createCatListWidget()
 
 void QJomeWindow::_buildUi()
 {
-    _wSearchBox = new QLineEdit;
     QObject::connect(_wSearchBox, &QLineEdit::textChanged,
                      this, &QJomeWindow::_searchTextChanged);
 
-    auto eventFilter = new QSearchBoxEventFilter {this};
+    auto eventFilter = new QSearchBoxEventFilter {this, _latencyProbe};
 
     _wSearchBox->installEventFilter(eventFilter);
     QObject::connect(eventFilter, &QSearchBoxEventFilter::upKeyPressed,
@@ -211,13 +237,18 @@ void QJomeWindow::_buildUi()
                      this, &QJomeWindow::_searchBoxHomeKeyPressed);
     QObject::connect(eventFilter, &QSearchBoxEventFilter::endKeyPressed,
                      this, &QJomeWindow::_searchBoxEndKeyPressed);
+    QObject::connect(eventFilter,
+                     &QSearchBoxEventFilter::preferredSkinToneKeyPressed,
+                     this, &QJomeWindow::_searchBoxPreferredSkinToneKeyPressed);
 
     auto mainVbox = new QVBoxLayout;
 
     mainVbox->setMargin(8);
     mainVbox->setSpacing(8);
     mainVbox->addWidget(_wSearchBox);
-    _wEmojis = new QEmojisWidget {nullptr, *_emojiDb};
+    _wEmojis = new QEmojisWidget {
+        nullptr, *_emojiDb, _emojiImages, _latencyProbe
+    };
     QObject::connect(_wEmojis, &QEmojisWidget::selectionChanged,
                      this, &QJomeWindow::_emojiSelectionChanged);
     QObject::connect(_wEmojis, &QEmojisWidget::emojiClicked,
@@ -226,6 +257,8 @@ void QJomeWindow::_buildUi()
                      this, &QJomeWindow::_emojiHoverEntered);
     QObject::connect(_wEmojis, &QEmojisWidget::emojiHoverLeaved,
                      this, &QJomeWindow::_emojiHoverLeaved);
+    QObject::connect(_wEmojis, &QEmojisWidget::findResultsEndReached,
+                     this, &QJomeWindow::_emojisFindResultsEndReached);
     _wCatList = this->_createCatListWidget();
     this->_wCatList->setCurrentRow(0);
 
@@ -238,67 +271,83 @@ void QJomeWindow::_buildUi()
     mainVbox->addLayout(emojisHbox);
     this->setLayout(mainVbox);
 
-    _wInfoLabel = new QLabel {""};
-    mainVbox->addWidget(_wInfoLabel);
+    _wInfo = new QEmojiInfoWidget {this, *_emojiDb, _emojiImages};
+    mainVbox->addWidget(_wInfo);
 }
 
-void QJomeWindow::reject()
+QWidget& QJomeWindow::_contentsWidget()
 {
-    this->hide();
-    emit this->canceled();
+    return *_wEmojis;
 }
 
-void QJomeWindow::accept()
+void QJomeWindow::_buildContents()
 {
+    _wEmojis->rebuild();
+    _wEmojis->showAllEmojis();
 }
 
-void QJomeWindow::showEvent(QShowEvent * const event)
+void QJomeWindow::_resetContents()
 {
-    QDialog::showEvent(event);
-
-    if (!_emojisWidgetBuilt) {
-        _wEmojis->rebuild();
-        _emojisWidgetBuilt = true;
-    }
-
     _wEmojis->showAllEmojis();
-    _wSearchBox->setFocus();
 }
 
-void QJomeWindow::closeEvent(QCloseEvent * const event)
+void QJomeWindow::_trimCaches()
 {
-    event->ignore();
-    this->hide();
-    emit this->canceled();
+    /*
+     * Keep what showing all the emojis needs (emoji PNG file, current
+     * layout) so that showing again still only needs a single paint.
+     */
+    _wEmojis->trimCaches();
+    _wInfo->trimCaches();
+    _emojiImages.trimCaches();
+    _findPos.reset();
+    _findResults.clear();
 }
 
-void QJomeWindow::_findEmojis(const std::string& cat,
-                              const std::string& needles)
+void QJomeWindow::_findEmojis()
 {
-    std::vector<const Emoji *> results;
+    _findPos.reset();
+    _findResults.clear();
 
-    _emojiDb->findEmojis(cat, needles, results);
-    _wEmojis->showFindResults(results);
+    /*
+     * Only find what fits on a single page for now: the emojis widget
+     * asks for more when the user reaches the end of the results.
+     */
+    _emojiDb->findEmojis(_findQuery, _findPos, _findResults,
+                         _wEmojis->pageEmojiCount());
+    this->_latencyProbeReached(LatencyProbe::Stage::FIND);
+    _wEmojis->showFindResults(_findResults);
+    this->_latencyProbeReached(LatencyProbe::Stage::GRID_UPDATE);
 }
 
-void QJomeWindow::_searchTextChanged(const QString& text)
+void QJomeWindow::_findMoreEmojis(const std::size_t maxCount)
 {
-    if (text.isEmpty()) {
-        _wEmojis->showAllEmojis();
+    if (_findPos.isDone()) {
         return;
     }
 
-    std::vector<std::string> parts;
-    const std::string textStr {text.toUtf8().constData()};
+    const auto prevCount = _findResults.size();
+
+    _emojiDb->findEmojis(_findQuery, _findPos, _findResults, maxCount);
+
+    if (_findResults.size() != prevCount) {
+        _wEmojis->addFindResults(_findResults);
+    }
+}
 
-    boost::split(parts, textStr, boost::is_any_of("/"));
+void QJomeWindow::_searchTextChanged(const QString& text)
+{
+    this->_latencyProbeReached(LatencyProbe::Stage::TEXT_CHANGED);
 
-    if (parts.size() != 2) {
-        this->_findEmojis("", textStr);
+    if (text.isEmpty()) {
+        _wEmojis->showAllEmojis();
+        this->_latencyProbeReached(LatencyProbe::Stage::GRID_UPDATE);
         return;
     }
 
-    this->_findEmojis(parts[0], parts[1]);
+    _findQuery.parse(reinterpret_cast<const char16_t *>(text.utf16()),
+                     static_cast<std::size_t>(text.size()));
+    this->_findEmojis();
 }
 
 void QJomeWindow::_catListItemSelectionChanged()
@@ -360,12 +409,17 @@ void QJomeWindow::_searchBoxHomeKeyPressed()
 
 void QJomeWindow::_searchBoxEndKeyPressed()
 {
+    if (!_wEmojis->showingAllEmojis()) {
+        // the last emoji is the last result: find all of them
+        this->_findMoreEmojis(std::numeric_limits<std::size_t>::max());
+    }
+
     _wEmojis->selectLast();
 }
 
 void QJomeWindow::_searchBoxEnterKeyPressed()
 {
-    this->_acceptSelectedEmoji(Emoji::SkinTone::NONE);
+    this->_acceptSelectedEmoji(_preferredSkinTone);
 }
 
 void QJomeWindow::_searchBoxF1KeyPressed()
@@ -393,25 +447,52 @@ void QJomeWindow::_searchBoxF5KeyPressed()
     this->_acceptSelectedEmoji(Emoji::SkinTone::DARK);
 }
 
+void QJomeWindow::_searchBoxPreferredSkinToneKeyPressed(const Emoji::SkinTone skinTone)
+{
+    // same key again: back to no skin tone
+    this->_setPreferredSkinTone(skinTone == _preferredSkinTone ?
+                                Emoji::SkinTone::NONE : skinTone);
+    _settings.setValue("preferred-skin-tone",
+                       static_cast<int>(_preferredSkinTone));
+}
+
+void QJomeWindow::_setPreferredSkinTone(const Emoji::SkinTone skinTone)
+{
+    _preferredSkinTone = skinTone;
+    _wEmojis->skinTone(skinTone);
+    _wInfo->preferredSkinTone(skinTone);
+}
+
 void QJomeWindow::_emojiSelectionChanged(const Emoji * const emoji)
 {
     _selectedEmoji = emoji;
-    this->_updateInfoLabel(emoji);
+    _wInfo->showEmoji(emoji);
 }
 
 void QJomeWindow::_emojiClicked(const Emoji& emoji)
 {
-    this->_acceptEmoji(emoji, Emoji::SkinTone::NONE);
+    this->_acceptEmoji(emoji, _preferredSkinTone);
 }
 
 void QJomeWindow::_emojiHoverEntered(const Emoji& emoji)
 {
-    this->_updateInfoLabel(&emoji);
+    _wInfo->showEmoji(&emoji);
 }
 
 void QJomeWindow::_emojiHoverLeaved(const Emoji& emoji)
 {
-    this->_updateInfoLabel(_selectedEmoji);
+    _wInfo->showEmoji(_selectedEmoji);
+}
+
+void QJomeWindow::_emojisFindResultsEndReached()
+{
+    this->_findMoreEmojis(_wEmojis->pageEmojiCount());
+}
+
+void QJomeWindow::_emojiImagesReady()
+{
+    _wEmojis->viewport()->update();
+    _wInfo->update();
 }
 
 void QJomeWindow::_acceptSelectedEmoji(const Emoji::SkinTone skinTone)
@@ -428,29 +509,9 @@ void QJomeWindow::_acceptEmoji(const Emoji& emoji,
     this->accept();
 }
 
-void QJomeWindow::_updateInfoLabel(const Emoji * const emoji)
+void QJomeWindow::emojiCatChanged(const EmojiCat& cat)
 {
-    QString text;
-
-    if (emoji) {
-        text += "<b>";
-        text += emoji->name().c_str();
-        text += "</b> <span style=\"color: #999\">(";
-
-        for (const auto codepoint : emoji->codepoints()) {
-            text += QString::number(codepoint, 16) + ", ";
-        }
-
-        text.truncate(text.size() - 2);
-        text += ")</span>";
-    }
-
-    _wInfoLabel->setText(text);
-}
-
-void QJomeWindow::emojiDbChanged()
-{
-    _wEmojis->rebuild();
+    _wEmojis->updateCatEmojis(cat);
     _wEmojis->showAllEmojis();
 }
 
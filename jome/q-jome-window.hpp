@@ -11,19 +11,21 @@
 #include <QObject>
 #include <QEvent>
 #include <QDialog>
-#include <QLabel>
 #include <QListWidget>
 #include <QScrollArea>
 #include <QGridLayout>
 #include <QPixmap>
-#include <QGraphicsScene>
-#include <QGraphicsView>
+#include <QSettings>
 #include <boost/optional.hpp>
 #include <functional>
 
 #include "emoji-db.hpp"
+#include "emoji-query.hpp"
 #include "emoji-images.hpp"
+#include "latency-probe.hpp"
+#include "q-picker-window.hpp"
 #include "q-emojis-widget.hpp"
+#include "q-emoji-info-widget.hpp"
 
 namespace jome {
 
@@ -33,7 +35,8 @@ class QSearchBoxEventFilter :
     Q_OBJECT
 
 public:
-    explicit QSearchBoxEventFilter(QObject *parent);
+    explicit QSearchBoxEventFilter(QObject *parent,
+                                   LatencyProbe *latencyProbe = nullptr);
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
@@ -53,37 +56,46 @@ signals:
     void pgDownKeyPressed();
     void homeKeyPressed();
     void endKeyPressed();
+
+    // Ctrl+F1 to Ctrl+F5
+    void preferredSkinToneKeyPressed(Emoji::SkinTone skinTone);
+
+private:
+    LatencyProbe * const _latencyProbe;
 };
 
 class QJomeWindow :
-    public QDialog
+    public QPickerWindow
 {
     Q_OBJECT
 
 public:
-    explicit QJomeWindow(const EmojiDb& emojiDb);
+    explicit QJomeWindow(const EmojiDb& emojiDb,
+                         const boost::optional<EmojiImages::FontSource>& emojiFontSource = boost::none,
+                         const boost::optional<EmojiImages::SvgSource>& emojiSvgSource = boost::none,
+                         LatencyProbe *latencyProbe = nullptr);
 
 signals:
     void emojiChosen(const Emoji& emoji, Emoji::SkinTone skinTone);
-    void canceled();
 
 public slots:
-    void emojiDbChanged();
+    void emojiCatChanged(const EmojiCat& cat);
 
 private:
-    void closeEvent(QCloseEvent *event) override;
-    void showEvent(QShowEvent *event) override;
-    void _setMainStyleSheet();
+    QWidget& _contentsWidget() override;
+    void _buildContents() override;
+    void _resetContents() override;
+    void _trimCaches() override;
+    void _setPalettesAndFonts();
     void _buildUi();
     QListWidget *_createCatListWidget();
-    void _updateInfoLabel(const Emoji *emoji);
-    void _findEmojis(const std::string& cat, const std::string& needles);
+    void _findEmojis();
+    void _findMoreEmojis(std::size_t maxCount);
     void _acceptSelectedEmoji(Emoji::SkinTone skinTone);
+    void _setPreferredSkinTone(Emoji::SkinTone skinTone);
     void _acceptEmoji(const Emoji& emoji, Emoji::SkinTone skinTone);
 
 private slots:
-    void reject() override;
-    void accept() override;
     void _searchTextChanged(const QString& text);
     void _catListItemSelectionChanged();
     void _catListItemClicked(QListWidgetItem *item);
@@ -101,19 +113,32 @@ private slots:
     void _searchBoxPgDownKeyPressed();
     void _searchBoxHomeKeyPressed();
     void _searchBoxEndKeyPressed();
+    void _searchBoxPreferredSkinToneKeyPressed(Emoji::SkinTone skinTone);
     void _emojiSelectionChanged(const Emoji *emoji);
     void _emojiClicked(const Emoji& emoji);
     void _emojiHoverEntered(const Emoji& emoji);
     void _emojiHoverLeaved(const Emoji& emoji);
+    void _emojisFindResultsEndReached();
+    void _emojiImagesReady();
 
 private:
     const EmojiDb * const _emojiDb;
+
+    // shared by the emojis and emoji info widgets
+    EmojiImages _emojiImages;
+
+    QSettings _settings;
+
+    // skin tone of Enter and of a click
+    Emoji::SkinTone _preferredSkinTone = Emoji::SkinTone::NONE;
+
     QEmojisWidget *_wEmojis = nullptr;
     QListWidget *_wCatList = nullptr;
-    QLabel *_wInfoLabel = nullptr;
-    QLineEdit *_wSearchBox = nullptr;
-    bool _emojisWidgetBuilt = false;
+    QEmojiInfoWidget *_wInfo = nullptr;
     const Emoji *_selectedEmoji = nullptr;
+    EmojiQuery _findQuery;
+    EmojiFindPos _findPos;
+    std::vector<const Emoji *> _findResults;
 };
 
 } // namespace jome
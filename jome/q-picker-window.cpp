@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QLayout>
+#include <QResizeEvent>
+#include <QCloseEvent>
+#include <QCoreApplication>
+#include <QFont>
+#include <QPalette>
+#include <QPixmap>
+#include <limits>
+#include <cassert>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <boost/optional.hpp>
+
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#include "q-picker-window.hpp"
+
+namespace jome {
+
+// resident set size of this process (bytes), if available
+static boost::optional<std::size_t> residentSetSize()
+{
+    std::ifstream statm {"/proc/self/statm"};
+    std::size_t totalPages, residentPages;
+
+    if (!(statm >> totalPages >> residentPages)) {
+        return boost::none;
+    }
+
+    return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static std::string formatSize(const boost::optional<std::size_t>& size)
+{
+    if (!size) {
+        return "?";
+    }
+
+    return std::to_string(*size / 1024) + " KiB";
+}
+
+QPickerWindow::QPickerWindow(LatencyProbe * const latencyProbe) :
+    QDialog {},
+    _latencyProbe {latencyProbe},
+    _wSearchBox {new QLineEdit}
+{
+    this->setWindowTitle("jome");
+    this->resize(800, 600);
+    this->setMinimumSize(400, 300);
+    this->setWindowFlags(Qt::Dialog);
+
+    _idleTrimTimer.setSingleShot(true);
+    QObject::connect(&_idleTrimTimer, &QTimer::timeout,
+                     this, &QPickerWindow::_idleTrimTimerTimeout);
+}
+
+void QPickerWindow::_setCommonPalettesAndFonts()
+{
+    /*
+     * Explicit palettes and fonts instead of a style sheet: style
+     * sheets make Qt match the rules against each widget when
+     * creating and polishing it. QJomeStyle draws the rest.
+     */
+    QFont font {"Hack, DejaVu Sans Mono, monospace"};
+
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPixelSize(12);
+    this->setFont(font);
+
+    auto palette = this->palette();
+
+    palette.setColor(QPalette::Window, QColor {"#333"});
+    this->setPalette(palette);
+
+    // find box
+    auto searchBoxFont = font;
+
+    searchBoxFont.setPixelSize(14);
+    searchBoxFont.setBold(true);
+    _wSearchBox->setFont(searchBoxFont);
+    _wSearchBox->setFrame(false);
+    _wSearchBox->setTextMargins(4, 4, 4, 4);
+    palette = _wSearchBox->palette();
+    palette.setColor(QPalette::Base, QColor {0, 0, 0, 51});
+    palette.setColor(QPalette::Text, QColor {"#f0f0f0"});
+    _wSearchBox->setPalette(palette);
+}
+
+void QPickerWindow::_latencyProbeReached(const LatencyProbe::Stage stage)
+{
+    if (_latencyProbe) {
+        _latencyProbe->reached(stage);
+    }
+}
+
+void QPickerWindow::reject()
+{
+    this->hide();
+    emit this->canceled();
+}
+
+void QPickerWindow::accept()
+{
+}
+
+void QPickerWindow::closeEvent(QCloseEvent * const event)
+{
+    event->ignore();
+    this->hide();
+    emit this->canceled();
+}
+
+void QPickerWindow::prepare()
+{
+    // create the native window and lay out the widgets without showing
+    this->ensurePolished();
+    this->layout()->activate();
+    this->winId();
+
+    /*
+     * A hidden widget only gets its resize events when shown: send the
+     * one of the contents widget now so that its viewport has its final
+     * size, and then build it for this size.
+     */
+    auto& contentsWidget = this->_contentsWidget();
+    QResizeEvent resizeEvent {contentsWidget.size(), contentsWidget.size()};
+
+    QCoreApplication::sendEvent(&contentsWidget, &resizeEvent);
+    this->_buildContentsOnce();
+
+    /*
+     * Render once offscreen so that the first real paint finds the
+     * pixmaps, glyphs, and static texts already cached.
+     */
+    QPixmap pixmap {this->size()};
+
+    this->render(&pixmap);
+}
+
+void QPickerWindow::_buildContentsOnce()
+{
+    if (_contentsBuilt) {
+        return;
+    }
+
+    this->_buildContents();
+    _contentsBuilt = true;
+}
+
+void QPickerWindow::idleTrimDelay(const int seconds)
+{
+    assert(seconds >= 0 && seconds <= std::numeric_limits<int>::max() / 1000);
+    _idleTrimTimer.setInterval(seconds * 1000);
+}
+
+void QPickerWindow::showEvent(QShowEvent * const event)
+{
+    QDialog::showEvent(event);
+    _idleTrimTimer.stop();
+
+    // no-op if prepared or shown before: the state was reset when hiding
+    this->_buildContentsOnce();
+    _wSearchBox->setFocus();
+}
+
+void QPickerWindow::hideEvent(QHideEvent * const event)
+{
+    QDialog::hideEvent(event);
+
+    // the next paint could be much later
+    if (_latencyProbe) {
+        _latencyProbe->cancel();
+    }
+
+    if (!_contentsBuilt) {
+        return;
+    }
+
+    // reset now so that showing again only needs to map the window
+    _wSearchBox->blockSignals(true);
+    _wSearchBox->clear();
+    _wSearchBox->blockSignals(false);
+    this->_resetContents();
+
+    if (_idleTrimTimer.interval() > 0) {
+        _idleTrimTimer.start();
+    }
+}
+
+void QPickerWindow::_idleTrimTimerTimeout()
+{
+    const auto rssBefore = residentSetSize();
+
+    this->_trimCaches();
+
+#ifdef __GLIBC__
+    // give the freed heap pages back to the system
+    malloc_trim(0);
+#endif
+
+    std::cerr << "Trimmed caches after " << _idleTrimTimer.interval() / 1000 <<
+                 " s hidden: RSS " << formatSize(rssBefore) << " -> " <<
+                 formatSize(residentSetSize()) << '.' << std::endl;
+}
+
+} // namespace jome
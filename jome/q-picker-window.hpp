@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_PICKER_WINDOW_HPP
+#define _JOME_Q_PICKER_WINDOW_HPP
+
+#include <QObject>
+#include <QDialog>
+#include <QLineEdit>
+#include <QTimer>
+
+#include "latency-probe.hpp"
+
+namespace jome {
+
+/*
+ * Keyboard-centric window to pick something with a find box above a
+ * grid: what QJomeWindow and QUnicodeWindow have in common.
+ *
+ * The grid is the contents widget. Once built, it's reset when the
+ * window is hidden so that showing it again only needs to map it, and
+ * its caches are trimmed when the window stays hidden.
+ */
+class QPickerWindow :
+    public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QPickerWindow(LatencyProbe *latencyProbe);
+
+    /*
+     * Sets the number of seconds after which to trim the caches once
+     * the window is hidden (0 to disable), at most `INT_MAX / 1000`.
+     */
+    void idleTrimDelay(int seconds);
+
+signals:
+    void canceled();
+
+public slots:
+    /*
+     * Creates the native window, lays out the widgets, builds the
+     * contents widget, and renders once offscreen, all without showing
+     * the window.
+     */
+    void prepare();
+
+protected:
+    // sets the font and palettes of the window and of the find box
+    void _setCommonPalettesAndFonts();
+
+    void _latencyProbeReached(LatencyProbe::Stage stage);
+
+private:
+    // grid widget below the find box
+    virtual QWidget& _contentsWidget() = 0;
+
+    // builds the contents widget for the first time
+    virtual void _buildContents() = 0;
+
+    // shows everything again in the contents widget
+    virtual void _resetContents() = 0;
+
+    // releases what's only needed while the window is shown
+    virtual void _trimCaches() = 0;
+
+    void closeEvent(QCloseEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void _buildContentsOnce();
+
+protected slots:
+    void reject() override;
+    void accept() override;
+
+private slots:
+    void _idleTrimTimerTimeout();
+
+protected:
+    // latency probe (`nullptr` if disabled)
+    LatencyProbe * const _latencyProbe;
+
+    // created here, laid out and connected by the subclass
+    QLineEdit * const _wSearchBox;
+
+private:
+    bool _contentsBuilt = false;
+
+    // trims the caches when the window stays hidden
+    QTimer _idleTrimTimer;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_PICKER_WINDOW_HPP
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QPainter>
+#include <QFontMetrics>
+
+#include "q-unicode-info-widget.hpp"
+
+namespace jome {
+
+QUnicodeInfoWidget::QUnicodeInfoWidget(QWidget * const parent,
+                                       const UnicodeDb& unicodeDb) :
+    QWidget {parent},
+    _unicodeDb {&unicodeDb}
+{
+    this->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+}
+
+QSize QUnicodeInfoWidget::sizeHint() const
+{
+    // the font is inherited from the window once it's a child
+    return {0, QFontMetrics {this->font()}.height() + 4};
+}
+
+void QUnicodeInfoWidget::showChar(const boost::optional<unsigned int>& charIndex)
+{
+    if (charIndex == _charIndex) {
+        return;
+    }
+
+    _charIndex = charIndex;
+    this->update();
+}
+
+void QUnicodeInfoWidget::trimCaches()
+{
+    for (auto it = _staticTexts.begin(); it != _staticTexts.end();) {
+        if (_charIndex && it->first == *_charIndex) {
+            ++it;
+        } else {
+            it = _staticTexts.erase(it);
+        }
+    }
+}
+
+const QStaticText& QUnicodeInfoWidget::_staticTextForChar(const unsigned int charIndex)
+{
+    auto& staticText = _staticTexts[charIndex];
+
+    if (!staticText.text().isEmpty()) {
+        return staticText;
+    }
+
+    QString text;
+
+    text += "<b>";
+    text += QString::fromStdString(_unicodeDb->name(charIndex)).toHtmlEscaped();
+    text += "</b> <span style=\"color: #999\">(U+";
+    text += QString::number(_unicodeDb->codepoint(charIndex), 16).toUpper().rightJustified(4, '0');
+    text += ")</span>";
+    staticText.setTextFormat(Qt::RichText);
+    staticText.setText(text);
+    return staticText;
+}
+
+void QUnicodeInfoWidget::paintEvent(QPaintEvent *)
+{
+    if (!_charIndex) {
+        return;
+    }
+
+    QPainter painter {this};
+    const auto& staticText = this->_staticTextForChar(*_charIndex);
+
+    painter.setFont(this->font());
+    painter.setPen(QColor {"#ff3366"});
+    painter.drawStaticText(0, (this->height() -
+                               static_cast<int>(staticText.size().height())) / 2,
+                           staticText);
+}
+
+} // namespace jome
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_UNICODE_INFO_WIDGET_HPP
+#define _JOME_Q_UNICODE_INFO_WIDGET_HPP
+
+#include <QWidget>
+#include <QStaticText>
+#include <boost/optional.hpp>
+#include <unordered_map>
+
+#include "unicode-db.hpp"
+
+namespace jome {
+
+/*
+ * Shows the name and codepoint of a single Unicode character.
+ *
+ * Like with QEmojiInfoWidget, the rich text of each character is only
+ * laid out the first time it's shown, then drawn from a cached static
+ * text. There are too many characters to keep a static text per
+ * character, therefore the cache only holds the ones shown so far.
+ */
+class QUnicodeInfoWidget :
+    public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit QUnicodeInfoWidget(QWidget *parent, const UnicodeDb& unicodeDb);
+    void showChar(const boost::optional<unsigned int>& charIndex);
+
+    // releases the static texts of the characters which aren't shown
+    void trimCaches();
+    QSize sizeHint() const override;
+
+private:
+    void paintEvent(QPaintEvent *event) override;
+    const QStaticText& _staticTextForChar(unsigned int charIndex);
+
+private:
+    const UnicodeDb * const _unicodeDb;
+    boost::optional<unsigned int> _charIndex;
+
+    // static texts, keyed by character index
+    std::unordered_map<unsigned int, QStaticText> _staticTexts;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_UNICODE_INFO_WIDGET_HPP
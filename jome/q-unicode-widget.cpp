@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QCursor>
+#include <algorithm>
+#include <cassert>
+
+#include "q-unicode-widget.hpp"
+
+namespace jome {
+
+// horizontal and vertical margin around the grid
+static constexpr int margin = 8;
+
+// size of the glyph box within its cell (same as an emoji)
+static constexpr int glyphBoxSize = 32;
+
+// width and height of a cell, including its margin
+static constexpr int cellSize = glyphBoxSize + 8;
+
+// size of the selection image around a glyph box
+static constexpr int selSize = 40;
+
+// maximum number of laid out glyphs to keep
+static constexpr std::size_t glyphTextsMaxCount = 4096;
+
+static QFont createGlyphFont()
+{
+    QFont font;
+
+    // any font which has the glyph (font fallback)
+    font.setPixelSize(24);
+    return font;
+}
+
+QUnicodeWidget::QUnicodeWidget(QWidget * const parent,
+                               const UnicodeDb& unicodeDb,
+                               LatencyProbe * const latencyProbe) :
+    QAbstractScrollArea {parent},
+    _unicodeDb {&unicodeDb},
+    _latencyProbe {latencyProbe},
+    _selPixmap {QString::fromStdString(std::string {JOME_DATA_DIR} + "/sel.png")},
+    _glyphFont {createGlyphFont()}
+{
+    this->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    this->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    this->viewport()->setMouseTracking(true);
+    QObject::connect(this->verticalScrollBar(), &QScrollBar::valueChanged,
+                     this, &QUnicodeWidget::_vertScrollBarValueChanged);
+}
+
+unsigned int QUnicodeWidget::_colCount() const
+{
+    const auto colCount = (this->viewport()->width() - margin) / cellSize;
+
+    return static_cast<unsigned int>(std::max(colCount, 1));
+}
+
+unsigned int QUnicodeWidget::_cellCount() const
+{
+    if (_showingAllChars) {
+        return static_cast<unsigned int>(_unicodeDb->charCount());
+    }
+
+    return static_cast<unsigned int>(_findResults.size());
+}
+
+unsigned int QUnicodeWidget::_charIndex(const unsigned int index) const
+{
+    return _showingAllChars ? index : _findResults[index];
+}
+
+QPoint QUnicodeWidget::_cellPos(const unsigned int index) const
+{
+    const auto colCount = this->_colCount();
+
+    return {
+        margin + static_cast<int>(index % colCount) * cellSize,
+        margin + static_cast<int>(index / colCount) * cellSize
+    };
+}
+
+boost::optional<unsigned int> QUnicodeWidget::_cellIndexAt(const QPoint& viewportPos) const
+{
+    const auto x = viewportPos.x() - margin;
+    const auto y = viewportPos.y() + this->verticalScrollBar()->value() - margin;
+
+    if (x < 0 || y < 0 || x % cellSize >= glyphBoxSize ||
+            y % cellSize >= glyphBoxSize) {
+        return boost::none;
+    }
+
+    const auto colCount = this->_colCount();
+    const auto col = static_cast<unsigned int>(x / cellSize);
+
+    if (col >= colCount) {
+        return boost::none;
+    }
+
+    const auto index = static_cast<unsigned int>(y / cellSize) * colCount + col;
+
+    if (index >= this->_cellCount()) {
+        return boost::none;
+    }
+
+    return index;
+}
+
+void QUnicodeWidget::_updateScrollBar()
+{
+    const auto colCount = this->_colCount();
+    const auto rowCount = (this->_cellCount() + colCount - 1) / colCount;
+    const auto height = 2 * margin + static_cast<int>(rowCount) * cellSize;
+    const auto viewportHeight = this->viewport()->height();
+    auto& scrollBar = *this->verticalScrollBar();
+
+    scrollBar.setRange(0, std::max(0, height - viewportHeight));
+    scrollBar.setPageStep(viewportHeight);
+    scrollBar.setSingleStep(cellSize / 2);
+}
+
+void QUnicodeWidget::showAllChars()
+{
+    _showingAllChars = true;
+    _hoveredIndex = boost::none;
+    this->_updateScrollBar();
+    this->viewport()->update();
+
+    if (_unicodeDb->charCount() == 0) {
+        this->_selectCell(boost::none);
+    } else {
+        this->_selectCell(0);
+    }
+}
+
+void QUnicodeWidget::showFindResults(const std::vector<std::uint32_t>& results)
+{
+    // assigning keeps the capacity of `_findResults`
+    _findResults = results;
+    _showingAllChars = false;
+    _hoveredIndex = boost::none;
+    this->_updateScrollBar();
+    this->viewport()->update();
+
+    if (results.empty()) {
+        this->_selectCell(boost::none);
+    } else {
+        this->_selectCell(0);
+    }
+}
+
+void QUnicodeWidget::addFindResults(const std::vector<std::uint32_t>& results)
+{
+    assert(!this->showingAllChars());
+    assert(results.size() >= _findResults.size());
+
+    const auto hadResults = !_findResults.empty();
+
+    // only add the results which we don't have yet
+    _findResults.insert(std::end(_findResults),
+                        std::begin(results) + _findResults.size(),
+                        std::end(results));
+    this->_updateScrollBar();
+    this->viewport()->update();
+
+    if (!hadResults && !results.empty()) {
+        this->_selectCell(0);
+    }
+}
+
+unsigned int QUnicodeWidget::pageCharCount() const
+{
+    const auto rowCount = this->viewport()->height() / cellSize + 1;
+
+    return this->_colCount() * static_cast<unsigned int>(rowCount);
+}
+
+const QStaticText& QUnicodeWidget::_glyphText(const unsigned int charIndex)
+{
+    const auto it = _glyphTexts.find(charIndex);
+
+    if (it != std::end(_glyphTexts)) {
+        return it->second;
+    }
+
+    if (_glyphTexts.size() >= glyphTextsMaxCount) {
+        // scrolling through everything mustn't keep everything
+        _glyphTexts.clear();
+    }
+
+    const uint ucs4 = _unicodeDb->codepoint(charIndex);
+    auto& staticText = _glyphTexts[charIndex];
+
+    staticText.setTextFormat(Qt::PlainText);
+    staticText.setText(QString::fromUcs4(&ucs4, 1));
+    staticText.prepare({}, _glyphFont);
+    return staticText;
+}
+
+void QUnicodeWidget::paintEvent(QPaintEvent * const event)
+{
+    QPainter painter {this->viewport()};
+    const auto& rect = event->rect();
+    const auto scrollY = this->verticalScrollBar()->value();
+    const auto colCount = this->_colCount();
+    const auto cellCount = this->_cellCount();
+    const auto firstRow = std::max(rect.top() + scrollY - margin, 0) / cellSize;
+    const auto lastRow = std::max(rect.bottom() + scrollY - margin, 0) / cellSize;
+
+    painter.fillRect(rect, QColor {"#f8f8f8"});
+    painter.setFont(_glyphFont);
+    painter.setPen(Qt::black);
+
+    // visible rows only
+    for (auto row = firstRow; row <= lastRow; ++row) {
+        const auto y = margin + row * cellSize - scrollY;
+
+        for (auto col = 0U; col < colCount; ++col) {
+            const auto index = static_cast<unsigned int>(row) * colCount + col;
+
+            if (index >= cellCount) {
+                break;
+            }
+
+            const auto& staticText = this->_glyphText(this->_charIndex(index));
+            const auto size = staticText.size();
+            const auto x = margin + static_cast<int>(col) * cellSize;
+
+            if (_hoveredIndex && *_hoveredIndex == index) {
+                painter.setOpacity(.5);
+            }
+
+            // center within the glyph box
+            painter.drawStaticText(QPointF {
+                x + (glyphBoxSize - size.width()) / 2,
+                y + (glyphBoxSize - size.height()) / 2
+            }, staticText);
+            painter.setOpacity(1.);
+        }
+    }
+
+    if (_selectedIndex) {
+        const auto pos = this->_cellPos(*_selectedIndex);
+
+        painter.drawPixmap(pos.x() - 4, pos.y() - 4 - scrollY, _selPixmap);
+    }
+
+    if (_latencyProbe) {
+        _latencyProbe->reached(LatencyProbe::Stage::PAINT);
+    }
+}
+
+void QUnicodeWidget::resizeEvent(QResizeEvent * const event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    // nothing to lay out: only the range changes
+    this->_updateScrollBar();
+}
+
+void QUnicodeWidget::scrollContentsBy(int, int)
+{
+    this->viewport()->update();
+
+    // what's under the mouse cursor changed
+    if (this->viewport()->underMouse()) {
+        this->_updateHoveredCell(this->viewport()->mapFromGlobal(QCursor::pos()));
+    }
+}
+
+void QUnicodeWidget::mouseMoveEvent(QMouseEvent * const event)
+{
+    this->_updateHoveredCell(event->pos());
+    QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void QUnicodeWidget::mousePressEvent(QMouseEvent * const event)
+{
+    if (event->button() == Qt::LeftButton) {
+        const auto index = this->_cellIndexAt(event->pos());
+
+        if (index) {
+            emit this->charClicked(this->_charIndex(*index));
+        }
+    }
+
+    QAbstractScrollArea::mousePressEvent(event);
+}
+
+bool QUnicodeWidget::viewportEvent(QEvent * const event)
+{
+    if (event->type() == QEvent::Leave) {
+        this->_updateHoveredCell({-1, -1});
+    }
+
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+void QUnicodeWidget::_updateCell(const unsigned int index)
+{
+    const auto pos = this->_cellPos(index);
+
+    // include the selection image
+    this->viewport()->update(pos.x() - 4,
+                             pos.y() - 4 - this->verticalScrollBar()->value(),
+                             selSize, selSize);
+}
+
+void QUnicodeWidget::_updateHoveredCell(const QPoint& viewportPos)
+{
+    const auto index = this->_cellIndexAt(viewportPos);
+
+    if (index == _hoveredIndex) {
+        return;
+    }
+
+    if (_hoveredIndex) {
+        this->_updateCell(*_hoveredIndex);
+        _hoveredIndex = boost::none;
+        emit this->charHoverLeaved();
+    }
+
+    _hoveredIndex = index;
+
+    if (index) {
+        this->_updateCell(*index);
+        emit this->charHoverEntered(this->_charIndex(*index));
+    }
+}
+
+void QUnicodeWidget::_vertScrollBarValueChanged(const int value)
+{
+    if (this->showingAllChars()) {
+        return;
+    }
+
+    if (value >= this->verticalScrollBar()->maximum()) {
+        emit this->findResultsEndReached();
+    }
+}
+
+void QUnicodeWidget::_selectCell(const boost::optional<unsigned int>& index)
+{
+    if (_selectedIndex) {
+        this->_updateCell(*_selectedIndex);
+    }
+
+    _selectedIndex = index;
+
+    if (!index) {
+        emit this->selectionChanged(boost::none);
+        return;
+    }
+
+    assert(*index < this->_cellCount());
+    this->_updateCell(*index);
+
+    if (*index == 0) {
+        this->verticalScrollBar()->setValue(0);
+    } else {
+        const auto selY = this->_cellPos(*index).y() - 4;
+        const auto candY = selY + 16 - this->viewport()->height() / 2;
+
+        this->verticalScrollBar()->setValue(std::max(0, candY));
+    }
+
+    emit this->selectionChanged(this->_charIndex(*index));
+
+    if (!this->showingAllChars() &&
+            _findResults.size() - *index <= 2 * this->_colCount()) {
+        // selection is within the last two rows: want more
+        emit this->findResultsEndReached();
+    }
+}
+
+void QUnicodeWidget::selectNext(const unsigned int count)
+{
+    if (!_selectedIndex) {
+        return;
+    }
+
+    const auto lastIndex = this->_cellCount() - 1;
+
+    this->_selectCell(*_selectedIndex +
+                      std::min(count, lastIndex - *_selectedIndex));
+}
+
+void QUnicodeWidget::selectPrevious(const unsigned int count)
+{
+    if (!_selectedIndex) {
+        return;
+    }
+
+    this->_selectCell(*_selectedIndex - std::min(count, *_selectedIndex));
+}
+
+void QUnicodeWidget::selectPreviousRow(const unsigned int count)
+{
+    if (!_selectedIndex) {
+        return;
+    }
+
+    const auto colCount = this->_colCount();
+    const auto rowCount = std::min(count, *_selectedIndex / colCount);
+
+    this->_selectCell(*_selectedIndex - rowCount * colCount);
+}
+
+void QUnicodeWidget::selectNextRow(const unsigned int count)
+{
+    if (!_selectedIndex) {
+        return;
+    }
+
+    // only the last row can be shorter
+    const auto colCount = this->_colCount();
+    const auto rowCount = std::min(count,
+                                   (this->_cellCount() - 1 - *_selectedIndex) /
+                                   colCount);
+
+    this->_selectCell(*_selectedIndex + rowCount * colCount);
+}
+
+void QUnicodeWidget::selectFirst()
+{
+    if (this->_cellCount() == 0) {
+        return;
+    }
+
+    this->_selectCell(0);
+}
+
+void QUnicodeWidget::selectLast()
+{
+    if (this->_cellCount() == 0) {
+        return;
+    }
+
+    this->_selectCell(this->_cellCount() - 1);
+}
+
+bool QUnicodeWidget::showingAllChars() const
+{
+    return _showingAllChars;
+}
+
+void QUnicodeWidget::trimCaches()
+{
+    decltype(_glyphTexts) {}.swap(_glyphTexts);
+
+    if (_showingAllChars) {
+        std::vector<std::uint32_t> {}.swap(_findResults);
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_UNICODE_WIDGET_HPP
+#define _JOME_Q_UNICODE_WIDGET_HPP
+
+#include <QObject>
+#include <QEvent>
+#include <QPixmap>
+#include <QFont>
+#include <QAbstractScrollArea>
+#include <QPainter>
+#include <QStaticText>
+#include <boost/optional.hpp>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "unicode-db.hpp"
+#include "latency-probe.hpp"
+
+namespace jome {
+
+/*
+ * Virtualized grid of Unicode characters.
+ *
+ * Unlike QEmojisWidget, there's no section: all the rows have the same
+ * height, so the position of a cell is only a function of its index
+ * and of the column count, and nothing is laid out beforehand, whatever
+ * the number of characters.
+ *
+ * The glyphs come from the system fonts (with Qt's font fallback), laid
+ * out the first time they're visible.
+ */
+class QUnicodeWidget :
+    public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit QUnicodeWidget(QWidget *parent, const UnicodeDb& unicodeDb,
+                            LatencyProbe *latencyProbe = nullptr);
+    void showAllChars();
+    void showFindResults(const std::vector<std::uint32_t>& results);
+    void addFindResults(const std::vector<std::uint32_t>& results);
+    unsigned int pageCharCount() const;
+    void selectNext(unsigned int count = 1);
+    void selectPrevious(unsigned int count = 1);
+    void selectPreviousRow(unsigned int count = 1);
+    void selectNextRow(unsigned int count = 1);
+    void selectFirst();
+    void selectLast();
+    bool showingAllChars() const;
+
+    // releases the laid out glyphs and the find results
+    void trimCaches();
+
+signals:
+    // `charIndex` is an index within the Unicode database
+    void selectionChanged(const boost::optional<unsigned int>& charIndex);
+    void charHoverEntered(unsigned int charIndex);
+    void charHoverLeaved();
+    void charClicked(unsigned int charIndex);
+    void findResultsEndReached();
+
+private:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void _selectCell(const boost::optional<unsigned int>& index);
+    void _updateScrollBar();
+    void _updateHoveredCell(const QPoint& viewportPos);
+    void _updateCell(unsigned int index);
+    const QStaticText& _glyphText(unsigned int charIndex);
+    unsigned int _colCount() const;
+    unsigned int _cellCount() const;
+    unsigned int _charIndex(unsigned int index) const;
+    QPoint _cellPos(unsigned int index) const;
+    boost::optional<unsigned int> _cellIndexAt(const QPoint& viewportPos) const;
+
+private slots:
+    void _vertScrollBarValueChanged(int value);
+
+private:
+    const UnicodeDb * const _unicodeDb;
+
+    // latency probe (`nullptr` if disabled)
+    LatencyProbe * const _latencyProbe;
+
+    const QPixmap _selPixmap;
+    const QFont _glyphFont;
+    bool _showingAllChars = true;
+
+    // current find results (character indexes)
+    std::vector<std::uint32_t> _findResults;
+
+    // laid out glyphs (by character index), cleared when too large
+    std::unordered_map<unsigned int, QStaticText> _glyphTexts;
+
+    boost::optional<unsigned int> _selectedIndex;
+    boost::optional<unsigned int> _hoveredIndex;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_UNICODE_WIDGET_HPP
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <limits>
+
+#include "q-unicode-window.hpp"
+#include "q-jome-window.hpp"
+
+namespace jome {
+
+QUnicodeWindow::QUnicodeWindow(const UnicodeDb& unicodeDb,
+                               LatencyProbe * const latencyProbe) :
+    QPickerWindow {latencyProbe},
+    _unicodeDb {&unicodeDb}
+{
+    /*
+     * Reserve the results so that finding characters doesn't allocate
+     * while the user types: the query reuses its buffer. The
+     * characters widget keeps the capacity of its own copy of the
+     * results once it has grown.
+     */
+    _findResults.reserve(unicodeDb.charCount());
+    this->_buildUi();
+    this->_setPalettesAndFonts();
+}
+
+void QUnicodeWindow::_setPalettesAndFonts()
+{
+    // same look as QJomeWindow
+    this->_setCommonPalettesAndFonts();
+
+    // characters
+    _wChars->setFrameShape(QFrame::NoFrame);
+}
+
+void QUnicodeWindow::_buildUi()
+{
+    QObject::connect(_wSearchBox, &QLineEdit::textChanged,
+                     this, &QUnicodeWindow::_searchTextChanged);
+
+    // F1 to F5 and Ctrl+F1 to Ctrl+F5 (skin tones) do nothing here
+    auto eventFilter = new QSearchBoxEventFilter {this, _latencyProbe};
+
+    _wSearchBox->installEventFilter(eventFilter);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::upKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxUpKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::rightKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxRightKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::downKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxDownKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::leftKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxLeftKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::enterKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxEnterKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::pgUpKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxPgUpKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::pgDownKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxPgDownKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::homeKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxHomeKeyPressed);
+    QObject::connect(eventFilter, &QSearchBoxEventFilter::endKeyPressed,
+                     this, &QUnicodeWindow::_searchBoxEndKeyPressed);
+
+    auto mainVbox = new QVBoxLayout;
+
+    mainVbox->setMargin(8);
+    mainVbox->setSpacing(8);
+    mainVbox->addWidget(_wSearchBox);
+    _wChars = new QUnicodeWidget {nullptr, *_unicodeDb, _latencyProbe};
+    QObject::connect(_wChars, &QUnicodeWidget::selectionChanged,
+                     this, &QUnicodeWindow::_charSelectionChanged);
+    QObject::connect(_wChars, &QUnicodeWidget::charClicked,
+                     this, &QUnicodeWindow::_charClicked);
+    QObject::connect(_wChars, &QUnicodeWidget::charHoverEntered,
+                     this, &QUnicodeWindow::_charHoverEntered);
+    QObject::connect(_wChars, &QUnicodeWidget::charHoverLeaved,
+                     this, &QUnicodeWindow::_charHoverLeaved);
+    QObject::connect(_wChars, &QUnicodeWidget::findResultsEndReached,
+                     this, &QUnicodeWindow::_charsFindResultsEndReached);
+    mainVbox->addWidget(_wChars);
+    _wInfo = new QUnicodeInfoWidget {this, *_unicodeDb};
+    mainVbox->addWidget(_wInfo);
+    this->setLayout(mainVbox);
+}
+
+QWidget& QUnicodeWindow::_contentsWidget()
+{
+    return *_wChars;
+}
+
+void QUnicodeWindow::_buildContents()
+{
+    _wChars->showAllChars();
+}
+
+void QUnicodeWindow::_resetContents()
+{
+    _wChars->showAllChars();
+}
+
+void QUnicodeWindow::_trimCaches()
+{
+    // keep the reserved capacity so that finding still doesn't allocate
+    _wChars->trimCaches();
+    _wInfo->trimCaches();
+    _findPos.reset();
+    _findResults.clear();
+}
+
+void QUnicodeWindow::_findChars()
+{
+    _findPos.reset();
+    _findResults.clear();
+
+    /*
+     * Only find what fits on a single page for now: the characters
+     * widget asks for more when the user reaches the end of the
+     * results.
+     */
+    _unicodeDb->findChars(_findQuery, _findPos, _findResults,
+                          _wChars->pageCharCount());
+    this->_latencyProbeReached(LatencyProbe::Stage::FIND);
+    _wChars->showFindResults(_findResults);
+    this->_latencyProbeReached(LatencyProbe::Stage::GRID_UPDATE);
+}
+
+void QUnicodeWindow::_findMoreChars(const std::size_t maxCount)
+{
+    if (_findPos.isDone()) {
+        return;
+    }
+
+    const auto prevCount = _findResults.size();
+
+    _unicodeDb->findChars(_findQuery, _findPos, _findResults, maxCount);
+
+    if (_findResults.size() != prevCount) {
+        _wChars->addFindResults(_findResults);
+    }
+}
+
+void QUnicodeWindow::_searchTextChanged(const QString& text)
+{
+    this->_latencyProbeReached(LatencyProbe::Stage::TEXT_CHANGED);
+
+    _findQuery.parse(reinterpret_cast<const char16_t *>(text.utf16()),
+                     static_cast<std::size_t>(text.size()));
+
+    if (_findQuery.wordCount() == 0 && !_findQuery.hasExtraWords()) {
+        _wChars->showAllChars();
+        this->_latencyProbeReached(LatencyProbe::Stage::GRID_UPDATE);
+        return;
+    }
+
+    this->_findChars();
+}
+
+void QUnicodeWindow::_searchBoxUpKeyPressed()
+{
+    _wChars->selectPreviousRow();
+}
+
+void QUnicodeWindow::_searchBoxRightKeyPressed()
+{
+    _wChars->selectNext();
+}
+
+void QUnicodeWindow::_searchBoxDownKeyPressed()
+{
+    _wChars->selectNextRow();
+}
+
+void QUnicodeWindow::_searchBoxLeftKeyPressed()
+{
+    _wChars->selectPrevious();
+}
+
+void QUnicodeWindow::_searchBoxPgUpKeyPressed()
+{
+    _wChars->selectPreviousRow(10);
+}
+
+void QUnicodeWindow::_searchBoxPgDownKeyPressed()
+{
+    _wChars->selectNextRow(10);
+}
+
+void QUnicodeWindow::_searchBoxHomeKeyPressed()
+{
+    _wChars->selectFirst();
+}
+
+void QUnicodeWindow::_searchBoxEndKeyPressed()
+{
+    if (!_wChars->showingAllChars()) {
+        // the last character is the last result: find all of them
+        this->_findMoreChars(std::numeric_limits<std::size_t>::max());
+    }
+
+    _wChars->selectLast();
+}
+
+void QUnicodeWindow::_searchBoxEnterKeyPressed()
+{
+    if (_selectedCharIndex) {
+        this->_acceptChar(*_selectedCharIndex);
+    }
+}
+
+void QUnicodeWindow::_charSelectionChanged(const boost::optional<unsigned int>& charIndex)
+{
+    _selectedCharIndex = charIndex;
+    _wInfo->showChar(charIndex);
+}
+
+void QUnicodeWindow::_charClicked(const unsigned int charIndex)
+{
+    this->_acceptChar(charIndex);
+}
+
+void QUnicodeWindow::_charHoverEntered(const unsigned int charIndex)
+{
+    _wInfo->showChar(charIndex);
+}
+
+void QUnicodeWindow::_charHoverLeaved()
+{
+    _wInfo->showChar(_selectedCharIndex);
+}
+
+void QUnicodeWindow::_charsFindResultsEndReached()
+{
+    this->_findMoreChars(_wChars->pageCharCount());
+}
+
+void QUnicodeWindow::_acceptChar(const unsigned int charIndex)
+{
+    emit this->charChosen(_unicodeDb->codepoint(charIndex));
+    this->accept();
+}
+
+} // namespace jome
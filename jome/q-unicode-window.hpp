@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_UNICODE_WINDOW_HPP
+#define _JOME_Q_UNICODE_WINDOW_HPP
+
+#include <QObject>
+#include <boost/optional.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "unicode-db.hpp"
+#include "unicode-query.hpp"
+#include "latency-probe.hpp"
+#include "q-unicode-widget.hpp"
+#include "q-unicode-info-widget.hpp"
+#include "q-picker-window.hpp"
+
+namespace jome {
+
+/*
+ * Same keyboard-centric window as QJomeWindow, but to pick any named
+ * Unicode character of a Unicode database, by name words or by
+ * codepoint.
+ */
+class QUnicodeWindow :
+    public QPickerWindow
+{
+    Q_OBJECT
+
+public:
+    explicit QUnicodeWindow(const UnicodeDb& unicodeDb,
+                            LatencyProbe *latencyProbe = nullptr);
+
+signals:
+    void charChosen(char32_t codepoint);
+
+private:
+    QWidget& _contentsWidget() override;
+    void _buildContents() override;
+    void _resetContents() override;
+    void _trimCaches() override;
+    void _setPalettesAndFonts();
+    void _buildUi();
+    void _findChars();
+    void _findMoreChars(std::size_t maxCount);
+    void _acceptChar(unsigned int charIndex);
+
+private slots:
+    void _searchTextChanged(const QString& text);
+    void _searchBoxUpKeyPressed();
+    void _searchBoxRightKeyPressed();
+    void _searchBoxDownKeyPressed();
+    void _searchBoxLeftKeyPressed();
+    void _searchBoxEnterKeyPressed();
+    void _searchBoxPgUpKeyPressed();
+    void _searchBoxPgDownKeyPressed();
+    void _searchBoxHomeKeyPressed();
+    void _searchBoxEndKeyPressed();
+    void _charSelectionChanged(const boost::optional<unsigned int>& charIndex);
+    void _charClicked(unsigned int charIndex);
+    void _charHoverEntered(unsigned int charIndex);
+    void _charHoverLeaved();
+    void _charsFindResultsEndReached();
+
+private:
+    const UnicodeDb * const _unicodeDb;
+    QUnicodeWidget *_wChars = nullptr;
+    QUnicodeInfoWidget *_wInfo = nullptr;
+    boost::optional<unsigned int> _selectedCharIndex;
+    UnicodeQuery _findQuery;
+    UnicodeFindPos _findPos;
+    std::vector<std::uint32_t> _findResults;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_UNICODE_WINDOW_HPP
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "thread-pool.hpp"
+
+namespace jome {
+
+ThreadPool::ThreadPool(const unsigned int threadCount)
+{
+    for (auto i = 0U; i < threadCount; ++i) {
+        _threads.emplace_back(&ThreadPool::_threadMain, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _stop = true;
+    }
+
+    _startCond.notify_all();
+
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::_run(const std::size_t count, const _TaskFunc taskFunc,
+                      void * const taskData)
+{
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _taskFunc = taskFunc;
+        _taskData = taskData;
+        _taskCount = count;
+        _nextTaskIndex = 0;
+        _busyThreadCount = this->threadCount();
+        ++_runGen;
+    }
+
+    _startCond.notify_all();
+
+    // also work on the calling thread
+    this->_work();
+
+    std::unique_lock<std::mutex> lock {_mutex};
+
+    _doneCond.wait(lock, [this]() {
+        return _busyThreadCount == 0;
+    });
+}
+
+void ThreadPool::_work()
+{
+    while (true) {
+        const auto index = _nextTaskIndex.fetch_add(1);
+
+        if (index >= _taskCount) {
+            return;
+        }
+
+        _taskFunc(_taskData, index);
+    }
+}
+
+void ThreadPool::_threadMain()
+{
+    unsigned long lastRunGen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock {_mutex};
+
+            _startCond.wait(lock, [this, lastRunGen]() {
+                return _stop || _runGen != lastRunGen;
+            });
+
+            if (_stop) {
+                return;
+            }
+
+            lastRunGen = _runGen;
+        }
+
+        this->_work();
+
+        {
+            std::lock_guard<std::mutex> lock {_mutex};
+
+            --_busyThreadCount;
+        }
+
+        _doneCond.notify_one();
+    }
+}
+
+} // namespace jome
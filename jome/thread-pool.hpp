@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_THREAD_POOL_HPP
+#define _JOME_THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+
+namespace jome {
+
+/*
+ * Small persistent pool of worker threads.
+ *
+ * Between calls to run(), the workers block on a condition variable
+ * without any timeout: an idle pool never wakes up.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount);
+    ~ThreadPool();
+
+    /*
+     * Calls `func(i)` for each `i` from 0 to `count` (excluded), in no
+     * particular order, on the worker threads and on the calling
+     * thread. Returns when all the calls are done.
+     */
+    template <typename FuncT>
+    void run(const std::size_t count, FuncT& func)
+    {
+        this->_run(count, [](void * const data, const std::size_t index) {
+            (*static_cast<FuncT *>(data))(index);
+        }, &func);
+    }
+
+    unsigned int threadCount() const noexcept
+    {
+        return static_cast<unsigned int>(_threads.size());
+    }
+
+private:
+    using _TaskFunc = void (*)(void *, std::size_t);
+
+private:
+    void _run(std::size_t count, _TaskFunc taskFunc, void *taskData);
+    void _work();
+    void _threadMain();
+
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _startCond;
+    std::condition_variable _doneCond;
+    bool _stop = false;
+    unsigned long _runGen = 0;
+    unsigned int _busyThreadCount = 0;
+    _TaskFunc _taskFunc = nullptr;
+    void *_taskData = nullptr;
+    std::size_t _taskCount = 0;
+    std::atomic<std::size_t> _nextTaskIndex {0};
+};
+
+} // namespace jome
+
+#endif // _JOME_THREAD_POOL_HPP
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+#include "unicode-db.hpp"
+
+namespace jome {
+
+// enough for the longest name, with its codepoint suffix
+static constexpr std::size_t nameBufSize = 256;
+
+UnicodeDb::UnicodeDb(const std::string& dir)
+{
+    this->_load(dir + "/unicode-names.txt");
+}
+
+void UnicodeDb::_load(const std::string& path)
+{
+    std::ifstream f {path};
+    std::string line;
+
+    // about 140,000 characters with about 1 MiB of names
+    _entries.reserve(1 << 18);
+    _names.reserve(1 << 20);
+
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        const auto spacePos = line.find(' ');
+
+        if (spacePos == std::string::npos) {
+            continue;
+        }
+
+        const auto cpStr = line.substr(0, spacePos);
+        const auto nameLen = std::min(line.size() - spacePos - 1,
+                                      nameBufSize - 16);
+        const auto nameOffset = static_cast<std::uint32_t>(_names.size());
+
+        _names.append(line, spacePos + 1, nameLen);
+
+        const auto rangeSepPos = cpStr.find("..");
+
+        if (rangeSepPos == std::string::npos) {
+            _entries.push_back({
+                static_cast<Codepoint>(std::strtoul(cpStr.c_str(), nullptr, 16)),
+                nameOffset, static_cast<std::uint16_t>(nameLen), false
+            });
+            continue;
+        }
+
+        const auto first = std::strtoul(cpStr.c_str(), nullptr, 16);
+        const auto last = std::strtoul(cpStr.c_str() + rangeSepPos + 2,
+                                       nullptr, 16);
+
+        for (auto cp = first; cp <= last; ++cp) {
+            _entries.push_back({
+                static_cast<Codepoint>(cp), nameOffset,
+                static_cast<std::uint16_t>(nameLen), true
+            });
+        }
+    }
+
+    _entries.shrink_to_fit();
+    _names.shrink_to_fit();
+}
+
+const char *UnicodeDb::_fullName(const _Entry& entry, char * const buf) const
+{
+    std::copy_n(_names.data() + entry.nameOffset, entry.nameLen, buf);
+
+    if (entry.hasCodepointSuffix) {
+        std::snprintf(buf + entry.nameLen, nameBufSize - entry.nameLen,
+                      "-%04X", static_cast<unsigned int>(entry.codepoint));
+    } else {
+        buf[entry.nameLen] = '\0';
+    }
+
+    return buf;
+}
+
+std::string UnicodeDb::name(const std::size_t index) const
+{
+    char buf[nameBufSize];
+
+    return this->_fullName(_entries[index], buf);
+}
+
+bool UnicodeDb::_findEntryIndex(const Codepoint codepoint,
+                                std::size_t& index) const
+{
+    const auto it = std::lower_bound(std::begin(_entries), std::end(_entries),
+                                     codepoint,
+                                     [](const _Entry& entry, const Codepoint cp) {
+        return entry.codepoint < cp;
+    });
+
+    if (it == std::end(_entries) || it->codepoint != codepoint) {
+        return false;
+    }
+
+    index = static_cast<std::size_t>(it - std::begin(_entries));
+    return true;
+}
+
+// codepoint of `word` (`1F600`, `U+1F600`), if it's one
+static bool parseCodepoint(std::string_view word, UnicodeDb::Codepoint& cp)
+{
+    if (word.size() > 2 && word.substr(0, 2) == "U+") {
+        word.remove_prefix(2);
+    }
+
+    if (word.empty() || word.size() > 6) {
+        return false;
+    }
+
+    cp = 0;
+
+    for (const auto ch : word) {
+        if (!std::isxdigit(static_cast<unsigned char>(ch))) {
+            return false;
+        }
+
+        cp = cp * 16 + static_cast<UnicodeDb::Codepoint>(ch <= '9' ?
+                                                         ch - '0' :
+                                                         ch - 'A' + 10);
+    }
+
+    return true;
+}
+
+void UnicodeDb::findChars(const UnicodeQuery& query, UnicodeFindPos& pos,
+                          std::vector<std::uint32_t>& results,
+                          const std::size_t maxCount) const
+{
+    if (query.wordCount() == 0 || query.hasExtraWords()) {
+        pos._isDone = true;
+        return;
+    }
+
+    const auto initialCount = results.size();
+    std::size_t hexIndex = std::numeric_limits<std::size_t>::max();
+    Codepoint cp;
+
+    if (query.wordCount() == 1 && parseCodepoint(*query.wordsBegin(), cp)) {
+        static_cast<void>(this->_findEntryIndex(cp, hexIndex));
+    }
+
+    if (!pos._hexDone) {
+        pos._hexDone = true;
+
+        if (hexIndex != std::numeric_limits<std::size_t>::max()) {
+            results.push_back(static_cast<std::uint32_t>(hexIndex));
+        }
+    }
+
+    char buf[nameBufSize];
+
+    for (; pos._entryIndex < _entries.size() &&
+            results.size() - initialCount < maxCount; ++pos._entryIndex) {
+        if (pos._entryIndex == hexIndex) {
+            // already first
+            continue;
+        }
+
+        const std::string_view name {
+            this->_fullName(_entries[pos._entryIndex], buf)
+        };
+
+        const auto allFound = std::all_of(query.wordsBegin(), query.wordsEnd(),
+                                          [&name](const std::string_view word) {
+            return name.find(word) != std::string_view::npos;
+        });
+
+        if (allFound) {
+            results.push_back(static_cast<std::uint32_t>(pos._entryIndex));
+        }
+    }
+
+    pos._isDone = pos._entryIndex == _entries.size();
+}
+
+} // namespace jome
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_UNICODE_DB_HPP
+#define _JOME_UNICODE_DB_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "unicode-query.hpp"
+
+namespace jome {
+
+class UnicodeDb;
+
+/*
+ * Position of a find operation within a Unicode database: pass the
+ * same position to UnicodeDb::findChars() to find more characters.
+ */
+class UnicodeFindPos
+{
+    friend class UnicodeDb;
+
+public:
+    void reset() noexcept
+    {
+        _entryIndex = 0;
+        _hexDone = false;
+        _isDone = false;
+    }
+
+    bool isDone() const noexcept
+    {
+        return _isDone;
+    }
+
+private:
+    std::size_t _entryIndex = 0;
+    bool _hexDone = false;
+    bool _isDone = false;
+};
+
+/*
+ * Database of all the named Unicode characters (about 140,000 of
+ * them), loaded from the `unicode-names.txt` file of the data
+ * directory.
+ *
+ * This file contains one entry per line, in codepoint order:
+ *
+ * `CP NAME`::
+ *     Character of which the codepoint is `CP` (hexadecimal) and the
+ *     name is `NAME`.
+ *
+ * `FIRST..LAST PREFIX`::
+ *     Characters from `FIRST` to `LAST` (hexadecimal, included), the
+ *     name of each one being `PREFIX` followed by `-` and its
+ *     codepoint (uppercase hexadecimal, at least four digits), like
+ *     `CJK UNIFIED IDEOGRAPH-4E00`.
+ *
+ * Lines starting with `#` are comments.
+ *
+ * To remain small, a database keeps all the names (or prefixes) in a
+ * single string and a compact entry per character: an entry is an
+ * index within the characters, in codepoint order.
+ */
+class UnicodeDb
+{
+public:
+    using Codepoint = char32_t;
+
+public:
+    explicit UnicodeDb(const std::string& dir);
+
+    std::size_t charCount() const noexcept
+    {
+        return _entries.size();
+    }
+
+    Codepoint codepoint(const std::size_t index) const noexcept
+    {
+        return _entries[index].codepoint;
+    }
+
+    // name of the character at `index`
+    std::string name(std::size_t index) const;
+
+    /*
+     * Appends to `results` the indexes of at most `maxCount` more
+     * characters matching `query`, starting at `pos`.
+     *
+     * The name of a matching character contains all the words of
+     * `query`. If `query` is a single word which is also a codepoint
+     * (hexadecimal, with an optional `U+` prefix), then its character
+     * comes first. A query without words or with extra words matches
+     * nothing.
+     *
+     * Doesn't allocate if `results` has enough capacity.
+     */
+    void findChars(const UnicodeQuery& query, UnicodeFindPos& pos,
+                   std::vector<std::uint32_t>& results,
+                   std::size_t maxCount) const;
+
+private:
+    struct _Entry
+    {
+        Codepoint codepoint;
+
+        // offset and length of the name (or prefix) within `_names`
+        std::uint32_t nameOffset;
+        std::uint16_t nameLen;
+
+        // name is the prefix, `-`, and the codepoint
+        bool hasCodepointSuffix;
+    };
+
+private:
+    void _load(const std::string& path);
+    const char *_fullName(const _Entry& entry, char *buf) const;
+    bool _findEntryIndex(Codepoint codepoint, std::size_t& index) const;
+
+private:
+    std::vector<_Entry> _entries;
+
+    // all the names and prefixes, uppercase, without separators
+    std::string _names;
+};
+
+} // namespace jome
+
+#endif // _JOME_UNICODE_DB_HPP
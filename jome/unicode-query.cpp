@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+
+#include "unicode-query.hpp"
+
+namespace jome {
+
+static bool isSpace(const char16_t ch) noexcept
+{
+    return ch == u' ' || ch == u'\t' || ch == u'\n' || ch == u'\r' ||
+           ch == u'\f' || ch == u'\v';
+}
+
+void UnicodeQuery::parse(const char16_t * const str, const std::size_t len)
+{
+    // `clear()` keeps the capacity of the buffer
+    _buf.clear();
+
+    for (std::size_t i = 0; i < len; ++i) {
+        const auto ch = str[i];
+
+        if (isSpace(ch)) {
+            _buf += ' ';
+        } else if (ch >= u'a' && ch <= u'z') {
+            _buf += static_cast<char>(ch - u'a' + 'A');
+        } else if (ch < 0x80) {
+            _buf += static_cast<char>(ch);
+        } else {
+            // not in any name
+            _buf += '\x7f';
+        }
+    }
+
+    _wordCount = 0;
+    _hasExtraWords = false;
+
+    // split into individual, non-empty words
+    std::string_view wordsStr {_buf};
+
+    while (!wordsStr.empty()) {
+        const auto spacePos = std::min(wordsStr.find(' '), wordsStr.size());
+
+        if (spacePos > 0) {
+            if (_wordCount == _words.size()) {
+                _hasExtraWords = true;
+                return;
+            }
+
+            _words[_wordCount] = wordsStr.substr(0, spacePos);
+            ++_wordCount;
+        }
+
+        wordsStr.remove_prefix(std::min(spacePos + 1, wordsStr.size()));
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_UNICODE_QUERY_HPP
+#define _JOME_UNICODE_QUERY_HPP
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace jome {
+
+/*
+ * Parsed Unicode character find query: a space-separated list of
+ * words.
+ *
+ * Like EmojiQuery, parse() copies the query string into a single
+ * buffer, and the words are views into this buffer: parse each new
+ * query string with the same instance to reuse this buffer.
+ *
+ * Character names are uppercase ASCII, therefore parse() converts the
+ * query to uppercase ASCII too, replacing any other character with a
+ * byte that no name contains.
+ *
+ * A query has at most `maxWordCount` words: a query with more has extra
+ * words (see hasExtraWords()), which no character matches.
+ */
+class UnicodeQuery
+{
+public:
+    static constexpr std::size_t maxWordCount = 16;
+
+public:
+    void parse(const char16_t *str, std::size_t len);
+
+    const std::string_view *wordsBegin() const noexcept
+    {
+        return _words.data();
+    }
+
+    const std::string_view *wordsEnd() const noexcept
+    {
+        return _words.data() + _wordCount;
+    }
+
+    std::size_t wordCount() const noexcept
+    {
+        return _wordCount;
+    }
+
+    // whether or not the query has more than `maxWordCount` words
+    bool hasExtraWords() const noexcept
+    {
+        return _hasExtraWords;
+    }
+
+private:
+    std::string _buf;
+    std::array<std::string_view, maxWordCount> _words;
+    std::size_t _wordCount = 0;
+    bool _hasExtraWords = false;
+};
+
+} // namespace jome
+
+#endif // _JOME_UNICODE_QUERY_HPP
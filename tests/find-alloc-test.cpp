@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2019 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "emoji-db.hpp"
+#include "emoji-query.hpp"
+
+/*
+ * Replays typing sequences in the find box, without the GUI, and fails
+ * if any keystroke allocates once the sequences were replayed a first
+ * time.
+ *
+ * A keystroke is what QJomeWindow does when the find box text changes:
+ * parse the query, find the first page of results, then find more
+ * results as if the user scrolled to the end.
+ *
+ * This doesn't cover showing the results (QEmojisWidget::showFindResults()
+ * and QEmojisWidget::addFindResults()): they only reuse the capacity of
+ * their own vectors, but the updates and the paint which follow go
+ * through Qt, which allocates its events.
+ */
+
+namespace {
+
+std::atomic<bool> counting {false};
+std::atomic<std::size_t> allocCount {0};
+
+void *countedAlloc(const std::size_t size)
+{
+    if (counting.load(std::memory_order_relaxed)) {
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (const auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc {};
+}
+
+} // namespace
+
+void *operator new(const std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](const std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void * const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void * const ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void * const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void * const ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+
+// results per page, like a large window
+constexpr std::size_t pageSize = 120;
+
+// find box texts, one per keystroke, including erasing
+std::vector<std::u16string> keystrokes()
+{
+    std::vector<std::u16string> texts;
+
+    const auto type = [&texts](const std::u16string& text) {
+        for (std::size_t len = 1; len <= text.size(); ++len) {
+            texts.push_back(text.substr(0, len));
+        }
+    };
+
+    const auto erase = [&texts](std::size_t count) {
+        auto text = texts.back();
+
+        while (count > 0 && !text.empty()) {
+            text.pop_back();
+            texts.push_back(text);
+            --count;
+        }
+    };
+
+    type(u"smiling face with heart");
+    erase(10);
+    type(u"th tears");
+    erase(100);
+    type(u"a");
+    erase(1);
+    type(u"people/hand");
+    erase(4);
+    type(u"thumbs up");
+    erase(100);
+    type(u"flag/");
+    type(u"ca");
+    erase(100);
+    type(u"logo 1");
+    return texts;
+}
+
+// replays `texts`, returning the number of allocating keystrokes
+std::size_t replay(const jome::EmojiDb& db,
+                   const std::vector<std::u16string>& texts,
+                   jome::EmojiQuery& query, jome::EmojiFindPos& pos,
+                   std::vector<const jome::Emoji *>& results,
+                   const bool check)
+{
+    std::size_t allocKeystrokeCount = 0;
+
+    for (const auto& text : texts) {
+        if (text.empty()) {
+            // QJomeWindow shows all the emojis instead
+            continue;
+        }
+
+        allocCount = 0;
+        counting = check;
+        query.parse(text.data(), text.size());
+        pos.reset();
+        results.clear();
+        db.findEmojis(query, pos, results, pageSize);
+
+        while (!pos.isDone()) {
+            db.findEmojis(query, pos, results, pageSize);
+        }
+
+        counting = false;
+
+        if (allocCount > 0) {
+            std::cerr << "Keystroke `" <<
+                         QString::fromStdU16String(text).toStdString() <<
+                         "` allocated " << allocCount << " time(s)." <<
+                         std::endl;
+            ++allocKeystrokeCount;
+        }
+    }
+
+    return allocKeystrokeCount;
+}
+
+// writes a custom emoji pack of `count` emojis to `dir`
+void writePack(const QString& dir, const std::size_t count)
+{
+    std::ofstream f {(dir + "/manifest.txt").toStdString()};
+
+    f << "@name Logos\n@shard shard.png\n";
+
+    for (std::size_t i = 0; i < count; ++i) {
+        f << "0 0 0 logo-" << i << " company brand\n";
+    }
+}
+
+// returns the number of allocating keystrokes with the database `db`
+std::size_t test(const jome::EmojiDb& db)
+{
+    const auto texts = keystrokes();
+    jome::EmojiQuery query;
+    jome::EmojiFindPos pos;
+    std::vector<const jome::Emoji *> results;
+
+    // like QJomeWindow
+    results.reserve(db.emojis().size());
+
+    // warm up
+    replay(db, texts, query, pos, results, false);
+
+    return replay(db, texts, query, pos, results, true);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    // don't touch the settings of the user
+    QCoreApplication app {argc, argv};
+
+    app.setOrganizationName("jome-tests");
+    app.setApplicationName("find-alloc-test");
+
+    if (argc != 2) {
+        std::cerr << "Usage: find-alloc-test DATA-DIR" << std::endl;
+        return 2;
+    }
+
+    std::size_t allocKeystrokeCount = 0;
+
+    {
+        const jome::EmojiDb db {argv[1]};
+
+        allocKeystrokeCount += test(db);
+    }
+
+    {
+        // enough emojis to find them in parallel shards
+        QTemporaryDir packDir;
+
+        writePack(packDir.path(), 20000);
+
+        const jome::EmojiDb db {argv[1], {packDir.path().toStdString()}};
+
+        allocKeystrokeCount += test(db);
+    }
+
+    if (allocKeystrokeCount > 0) {
+        std::cerr << allocKeystrokeCount <<
+                     " keystroke(s) allocated after warm-up." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}